@@ -4,8 +4,25 @@
 
 #ifndef BATTLESNAKE_H
 #define BATTLESNAKE_H
+#include "bitboard.h"
+#include "body_ring.h"
+#include "engine_config.h"
+#include "grid.h"
 #include "json.h"
+#include "neighbor_table.h"
+#include "timing.h"
+#include "transposition.h"
+#include "zobrist.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <type_traits>
+#include <utility>
 using json = nlohmann::json;
 
 namespace battlesnake {
@@ -17,6 +34,12 @@ namespace battlesnake {
         bool operator==(const Coord& other) const {
             return x == other.x && y == other.y;
         }
+        Cell index(int width) const {
+            return static_cast<Cell>(y * width + x);
+        }
+        static Coord fromIndex(Cell index, int width) {
+            return Coord(index % width, index / width);
+        }
 
         int x;
         int y;
@@ -32,21 +55,93 @@ namespace battlesnake {
         std::string tail;
     };
 
-    class Board {
+    //Metadata for a snake that search never touches, parsed once and shared by board copies
+    struct SnakeInfo {
+        std::string m_id;
+        Customizations m_customizations;
+        std::string m_name;
+        std::string m_shout;
+        int m_latency;
+
+        explicit SnakeInfo(const json& snake);
+    };
+
+    /*
+    Hot per-snake state stored as parallel arrays indexed by snake slot. Slots follow the order
+    of the snakes in the request and stand in for the string IDs everywhere past parsing.
+    */
+    struct SnakeStore {
+        int count = 0;
+        std::array<Cell, MAX_SNAKES> heads;
+        std::array<int, MAX_SNAKES> health;
+        std::array<int, MAX_SNAKES> lengths;
+        std::array<bool, MAX_SNAKES> alive;
+        std::array<BodyRing, MAX_SNAKES> bodies;
+    };
+
+    //One direction per snake slot; entries for dead or missing snakes are ignored
+    using JointMove = std::array<Direction, MAX_SNAKES>;
+
+    //Everything applyJointMove overwrites, so undo can restore the board exactly
+    struct UndoRecord {
+        uint64_t hash;
+        uint32_t moved = 0;  //Bit per snake slot that was moved
+        uint32_t ate = 0;    //Bit per snake slot that ate this turn
+        std::array<Cell, MAX_SNAKES> tails;
+        std::array<int, MAX_SNAKES> health;
+        std::array<int, MAX_SNAKES> head_free_at;
+        uint32_t eliminated = 0;  //Bit per snake slot removed by Rules::step
+        Bitboard spawned_food;    //Food placed by Rules::step
+    };
+
+    class Rules;
+    class GameEngine;
+
+    /*
+    Position state the search copies and steps. Everything is fixed-size data sized for the
+    largest supported board, so copying it is a single memcpy that never allocates.
+    */
+    class BoardState {
+    public:
+        int m_height;
+        int m_width;
+        SnakeStore m_snakes;
+        CellArray<int> m_heads_array;
+        //Ply at which each cell can next be moved into; at the parsed position this is turns until free
+        CellArray<int> m_obstacles_array;
+        const NeighborTable* m_neighbor_table;
+        BitboardGeometry m_geometry;
+        Bitboard m_occupied_bits;
+        Bitboard m_food_bits;
+        Bitboard m_hazard_bits;
+        Bitboard m_head_bits;
+
+    protected:
+        friend class Rules;
+
+        //Free masks kept for the first turns ahead, later ones are computed on demand
+        static constexpr int FREE_MASKS = 32;
+
+        BoardState(int width, int height, bool wrapped);
+
+        //Number of body segments in each cell, stacked tails counted separately
+        CellArray<uint8_t> m_occupancy;
+        //m_free_after[t] holds every cell that can be moved into t turns from now, rebuilt lazily after moves
+        mutable std::array<Bitboard, FREE_MASKS> m_free_after;
+        mutable int m_free_after_count = 0;
+        mutable bool m_free_after_valid = false;
+        uint64_t m_hash;
+        int m_ply = 0;
+    };
+    static_assert(std::is_trivially_copyable_v<BoardState>, "board copies in search must stay a memcpy");
+
+    //A BoardState plus the snakes' metadata, which copies share
+    class Board: public BoardState {
     public:
-        struct Snake {
-            std::string m_id;
-            Coord m_head;
-            Customizations m_customizations;
-            std::string m_name;
-            int m_health;
-            int m_length;
-            std::string m_shout;
-            int m_latency;
-            std::vector<Coord> m_body;
-
-            explicit Snake(const json& snake);
-            std::string getDirectionStr(const Coord& destination) const;
+        struct VolumeFrontierNode {
+            Cell head;
+            Bitboard path;
+            int length;
         };
         struct AStarFrontierNode {
             std::vector<Coord> path;
@@ -62,38 +157,65 @@ namespace battlesnake {
             int food_count;
         };
 
-        explicit Board(const json& board);
-        std::vector<Coord> getNeighbors(const Coord& pos) const;
-        std::vector<std::vector<int>> getObstacles() const;
-        std::vector<std::vector<bool>> getFood() const;
-        std::vector<std::vector<int>> getHeadsArray() const;
-        bool getHunger(const Snake& subject) const;
-        std::vector<Coord> simulateOptions(const Coord& pos, const int& sim_time) const;
+        explicit Board(const json& board, bool wrapped = false);
+        const NeighborList& getNeighbors(Cell pos) const;
+        Grid<int> getObstacles() const;
+        Grid<bool> getFood() const;
+        const CellArray<int>& getHeadsArray() const;
+        bool getHunger(int subject) const;
+        int snakeIndex(const std::string& snake_id) const;
+        std::string getDirectionStr(int snake, const Coord& destination) const;
+        const SnakeInfo& snakeInfo(int snake) const {return (*m_snake_info)[snake];}
+        uint64_t hash() const {return m_hash;}
+        int ply() const {return m_ply;}
+        //Turns until the cell can be moved into, 0 when it is free or only holds a tail
+        int obstacleTimer(Cell c) const {
+            return m_occupied_bits.test(c) ? std::max(0, m_obstacles_array[c] - m_ply) : 0;
+        }
+        int aliveCount() const;
+        bool isOccupied(Cell c) const {return m_occupied_bits.test(c);}
+        UndoRecord applyJointMove(const JointMove& moves);
+        void undo(const UndoRecord& record);
+        uint64_t computeHash() const;
+        //Takes over the food and hazards of a board of the same size, keeping the hash in step
+        void copyItems(const Board& other);
+        Cell toCell(const Coord& pos) const {
+            return pos.index(m_width);
+        }
+        Coord toCoord(Cell cell) const {
+            return Coord::fromIndex(cell, m_width);
+        }
+        Bitboard freeAfter(int turns) const;
+        NeighborList simulateOptions(Cell pos, int sim_time) const;
+        int floodFill(const Coord& start, int max_turns) const;
         int measureVolume(
             const Coord& start, const int& subject_length, bool avoid_heads, 
-            const std::vector<std::vector<int>>* head_threats = nullptr
+            const Grid<int>* head_threats = nullptr
         ) const;
         int manDist(const Coord& start_pos, const Coord& end_pos) const;
         std::vector<Coord> aStar(const Coord& start_pos, const Coord& end_pos) const;
         int getFoodDist(const Coord& pos) const;
-        std::vector<std::vector<int>> getHeadThreat(const Snake& subject) const;
+        Grid<int> getHeadThreat(int subject) const;
         std::string getMove(const std::string& snake_id) const;
 
-        int m_height;
-        int m_width;
-        std::vector<Snake> m_snakes;
-        std::vector<std::vector<int>> m_heads_array;
-        std::vector<std::vector<int>> m_obstacles_array;
-        std::vector<std::vector<bool>> m_food_array;
-
     private:
-        std::vector<Coord> m_food;
-        std::vector<Coord> m_hazards;
+        friend class Rules;
+
+        int bodyFreeAt(Cell c) const;
+        void removeSnake(int snake);
+        void restoreSnake(int snake);
+
+        void rebuildFreeMasks() const;
+
+        std::shared_ptr<const std::vector<SnakeInfo>> m_snake_info;
     };
 
     class RulesetSettings {
     public:
         explicit RulesetSettings(json ruleset_settings);
+        int getFoodSpawnChance() const {return foodspawnChance;}
+        int getMinimumFood() const {return minimumFood;}
+        int getHazardDamagePerTurn() const {return hazardDamagePerTurn;}
 
     private:
         int foodspawnChance;
@@ -104,6 +226,8 @@ namespace battlesnake {
     class Ruleset {
     public:
         explicit Ruleset(json ruleset);
+        const std::string& name() const {return m_name;}
+        const RulesetSettings& getSettings() const {return settings;}
 
     private:
         std::string m_name;
@@ -114,6 +238,9 @@ namespace battlesnake {
     class Game {
     public:
         explicit Game(const json& game);
+        bool isWrapped() const;
+        const Ruleset& getRuleset() const {return ruleset;}
+        int getTimeout() const {return timeout;}
         std::string id;
 
     private:
@@ -126,7 +253,17 @@ namespace battlesnake {
     class GameState {
     public:
         explicit GameState(const json& state);
-        std::string getMyMove() const;
+        //Searches with the game's engine, or plays the heuristic move without one
+        std::string getMyMove(SearchClock::time_point deadline, GameEngine* engine) const;
+        const std::string& getGameId() const {return game.id;}
+        const RulesetSettings& getRulesetSettings() const {return game.getRuleset().getSettings();}
+        int getTimeout() const {return game.getTimeout();}
+        //Latency the engine measured for our response to the previous turn
+        int getMyLatency() const;
+        int getTurn() const {return turn;}
+        uint64_t getHash() const {return board.hash();}
+        const std::string& getYouId() const {return you_id;}
+        int getSnakeCount() const {return board.m_snakes.count;}
 
     private:
         Game game;
@@ -153,18 +290,53 @@ namespace battlesnake {
 
     class BattleSnake {
     public:
-        BattleSnake();
+        explicit BattleSnake(const EngineConfig& config = EngineConfig());
 
         std::string getInfo() const;
 
-        std::string start();
+        std::string start(const json& state);
 
-        std::string make_move(const json& state);
+        std::string make_move(const json& state, SearchClock::time_point arrival);
 
-        std::string end();
+        std::string end(const json& state);
 
     private:
+        /*
+        Last response per game, so a retried /move for the same position is answered immediately.
+        The hash only filters, a hit must also match our snake and the whole board as sent.
+        */
+        struct CachedMove {
+            int turn;
+            uint64_t hash;
+            std::string you_id;
+            json board;
+            std::string response;
+        };
+        //Everything kept for one of our snakes in a game between requests, created by /start and released by /end
+        struct GameSession {
+            std::mutex mutex;  //Held through a whole request, so a retry waits for the answer and reuses it
+            TimeManager time_manager;
+            std::optional<CachedMove> last_move;
+            std::unique_ptr<GameEngine> engine;  //Search trees and pondering, absent for the heuristic engine
+            SearchClock::time_point last_used;   //Guarded by sessions_mutex
+        };
+        //Once this many games are open, the one that went longest without a request is dropped
+        static constexpr size_t MAX_SESSIONS = 16;
+
+        std::shared_ptr<GameSession> newSession(const GameState& state);
+        std::shared_ptr<GameSession> findSession(const GameState& state);
+        std::shared_ptr<GameSession> evictSession();
+
         Info info;
+        EngineConfig config;
+        //Shared by every game, its entries are keyed by the whole position and the snake searched for
+        TranspositionTable transposition_table;
+        //Games choosing a move right now; pondering stops while any is
+        std::atomic<int> choosing_moves{0};
+        std::mutex sessions_mutex;
+        //Keyed by game and our snake's ID, so two of our snakes in one game search apart
+        using SessionKey = std::pair<std::string, std::string>;
+        std::map<SessionKey, std::shared_ptr<GameSession>> sessions;
     };
 } // battlesnake
 
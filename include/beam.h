@@ -0,0 +1,57 @@
+#ifndef BEAM_H
+#define BEAM_H
+#include "search.h"
+#include <vector>
+
+namespace battlesnake {
+    //Beam width bounds; the width in between follows the time left
+    constexpr int MIN_BEAM_WIDTH = 4;
+    constexpr int MAX_BEAM_WIDTH = 512;
+    //Turns the width is planned for, so the beam reaches a useful depth before it widens
+    constexpr int BEAM_TARGET_DEPTH = 16;
+
+    /*
+    Beam search for deadlines too short for the full searches. Each turn, every kept position
+    tries each of our legal moves against one cheap reply: an opponent head at least as long
+    that can meet ours does, everyone else plays its default move. The children are scored with
+    quickEvaluate and the best width of them kept. The width is worked out again before every
+    turn from the time left and what a child has cost so far, so the search stops on time
+    however many moves there are. Our move is the first move on the line to the best position
+    of the deepest turn finished.
+    */
+    class BeamSearch {
+    public:
+        explicit BeamSearch(const Rules& rules);
+
+        SearchResult search(const Board& root, int subject, const SearchLimits& limits);
+
+    private:
+        struct State {
+            Board board;
+            Direction first;  //Our move at the root on the way here
+            int score;
+            bool decided;
+        };
+        struct Candidate {
+            int parent;
+            JointMove moves;
+            int score;
+            bool decided;
+        };
+
+        JointMove reply(const Board& board, Direction our_move) const;
+        bool scoreState(const Board& board, int ply, int& score) const;
+        bool timeUp() const;
+        int nextWidth(SearchClock::time_point turn_start, int children, int depth) const;
+
+        Rules m_rules;
+        int m_subject = 0;
+        bool m_solo = false;
+        SearchLimits m_limits;
+        std::vector<State> m_beam;
+        std::vector<State> m_next;
+        std::vector<Candidate> m_candidates;
+    };
+} // battlesnake
+
+#endif //BEAM_H
@@ -0,0 +1,27 @@
+#ifndef BENCH_H
+#define BENCH_H
+#include <ostream>
+
+namespace battlesnake {
+    constexpr int DEFAULT_BENCH_DEPTH = 7;
+
+    /*
+    Fixed-depth alpha-beta over a built-in set of positions, printing the nodes each search took
+    and the totals. The node total only moves when the search itself changes, so it measures how
+    much an ordering or pruning change shrinks the tree, while nodes per second measures the cost
+    of a node. Runs on one thread with a fresh transposition table per position.
+    */
+    void runBench(int depth, std::ostream& out);
+
+    constexpr int DEFAULT_SELFCHECK_GAMES = 200;
+
+    /*
+    Random games from the bench positions, plus a head running into a body, checking that a
+    stacked tail changes the hash and every Rules::step against the same position parsed from scratch (hash and per-cell obstacle timers)
+    and every undo against the position before the step. Prints what differs and returns the
+    number of failed checks.
+    */
+    int runSelfCheck(int games, std::ostream& out);
+} // battlesnake
+
+#endif //BENCH_H
@@ -0,0 +1,176 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+#include <array>
+#include <bit>
+#include <cstdint>
+
+namespace battlesnake {
+    //Largest board supported by the fixed width bitboards
+    constexpr int MAX_BOARD_DIM = 25;
+    constexpr int MAX_CELLS = MAX_BOARD_DIM * MAX_BOARD_DIM;
+
+    /*
+    Fixed width set with one bit per board cell. Cells are indexed row-major (y * width + x),
+    so shifting by one moves every cell sideways and shifting by the board width moves every
+    cell one row up or down.
+    */
+    class Bitboard {
+    public:
+        static constexpr int WORDS = (MAX_CELLS + 63) / 64;
+
+        constexpr Bitboard(): m_words{} {}
+
+        bool test(int i) const {
+            return (m_words[i >> 6] >> (i & 63)) & 1;
+        }
+        void set(int i) {
+            m_words[i >> 6] |= uint64_t{1} << (i & 63);
+        }
+        void reset(int i) {
+            m_words[i >> 6] &= ~(uint64_t{1} << (i & 63));
+        }
+        void clear() {
+            m_words.fill(0);
+        }
+        bool any() const {
+            for (uint64_t w : m_words) {
+                if (w) {return true;}
+            }
+            return false;
+        }
+        int count() const {
+            int total = 0;
+            for (uint64_t w : m_words) {
+                total += std::popcount(w);
+            }
+            return total;
+        }
+        //Returns the lowest set index, or -1 when empty
+        int first() const {
+            for (int i=0; i<WORDS; i++) {
+                if (m_words[i]) {
+                    return i * 64 + std::countr_zero(m_words[i]);
+                }
+            }
+            return -1;
+        }
+        //Calls f(index) for every set bit in ascending order
+        template<class F>
+        void forEach(F&& f) const {
+            for (int i=0; i<WORDS; i++) {
+                uint64_t w = m_words[i];
+                while (w) {
+                    f(i * 64 + std::countr_zero(w));
+                    w &= w - 1;
+                }
+            }
+        }
+
+        Bitboard& operator|=(const Bitboard& other) {
+            for (int i=0; i<WORDS; i++) {m_words[i] |= other.m_words[i];}
+            return *this;
+        }
+        Bitboard& operator&=(const Bitboard& other) {
+            for (int i=0; i<WORDS; i++) {m_words[i] &= other.m_words[i];}
+            return *this;
+        }
+        Bitboard& operator^=(const Bitboard& other) {
+            for (int i=0; i<WORDS; i++) {m_words[i] ^= other.m_words[i];}
+            return *this;
+        }
+        friend Bitboard operator|(Bitboard a, const Bitboard& b) {return a |= b;}
+        friend Bitboard operator&(Bitboard a, const Bitboard& b) {return a &= b;}
+        friend Bitboard operator^(Bitboard a, const Bitboard& b) {return a ^= b;}
+        bool operator==(const Bitboard& other) const {return m_words == other.m_words;}
+
+        //Bits set here but not in other
+        Bitboard andNot(const Bitboard& other) const {
+            Bitboard result;
+            for (int i=0; i<WORDS; i++) {
+                result.m_words[i] = m_words[i] & ~other.m_words[i];
+            }
+            return result;
+        }
+
+        //Moves every bit n places towards higher indices
+        Bitboard shiftUp(int n) const {
+            Bitboard result;
+            const int word_shift = n >> 6;
+            const int bit_shift = n & 63;
+            for (int i=WORDS-1; i>=word_shift; i--) {
+                uint64_t w = m_words[i - word_shift] << bit_shift;
+                if (bit_shift != 0 && i - word_shift > 0) {
+                    w |= m_words[i - word_shift - 1] >> (64 - bit_shift);
+                }
+                result.m_words[i] = w;
+            }
+            return result;
+        }
+        //Moves every bit n places towards lower indices
+        Bitboard shiftDown(int n) const {
+            Bitboard result;
+            const int word_shift = n >> 6;
+            const int bit_shift = n & 63;
+            for (int i=0; i+word_shift<WORDS; i++) {
+                uint64_t w = m_words[i + word_shift] >> bit_shift;
+                if (bit_shift != 0 && i + word_shift + 1 < WORDS) {
+                    w |= m_words[i + word_shift + 1] << (64 - bit_shift);
+                }
+                result.m_words[i] = w;
+            }
+            return result;
+        }
+
+    private:
+        std::array<uint64_t, WORDS> m_words;
+    };
+
+    //Board-size specific masks used to expand bitboards by one step in every direction
+    class BitboardGeometry {
+    public:
+        BitboardGeometry(int width, int height, bool wrapped = false):
+            m_width(width), m_height(height), m_wrapped(wrapped)
+        {
+            for (int y=0; y<height; y++) {
+                for (int x=0; x<width; x++) {
+                    const int i = y * width + x;
+                    m_all.set(i);
+                    if (x == 0) {m_first_col.set(i);}
+                    if (x == width - 1) {m_last_col.set(i);}
+                    if (y == 0) {m_first_row.set(i);}
+                    if (y == height - 1) {m_last_row.set(i);}
+                }
+            }
+        }
+
+        //All cells adjacent to at least one cell in bb
+        Bitboard neighbors(const Bitboard& bb) const {
+            Bitboard result = bb.andNot(m_last_col).shiftUp(1);
+            result |= bb.andNot(m_first_col).shiftDown(1);
+            result |= bb.shiftUp(m_width);
+            result |= bb.shiftDown(m_width);
+            if (m_wrapped) {
+                result |= (bb & m_last_col).shiftDown(m_width - 1);
+                result |= (bb & m_first_col).shiftUp(m_width - 1);
+                result |= (bb & m_last_row).shiftDown(m_width * (m_height - 1));
+                result |= (bb & m_first_row).shiftUp(m_width * (m_height - 1));
+            }
+            return result & m_all;
+        }
+        const Bitboard& all() const {return m_all;}
+        int width() const {return m_width;}
+        int height() const {return m_height;}
+
+    private:
+        int m_width;
+        int m_height;
+        bool m_wrapped;
+        Bitboard m_all;
+        Bitboard m_first_col;
+        Bitboard m_last_col;
+        Bitboard m_first_row;
+        Bitboard m_last_row;
+    };
+} // battlesnake
+
+#endif //BITBOARD_H
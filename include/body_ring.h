@@ -0,0 +1,160 @@
+#ifndef BODY_RING_H
+#define BODY_RING_H
+#include "bitboard.h"
+#include "neighbor_table.h"
+#include <array>
+
+namespace battlesnake {
+    /*
+    Snake body stored head first as its head and tail cells plus a circular buffer of 2-bit
+    links, the direction from each segment to the next. Bodies are contiguous, and segments
+    sharing a cell only ever sit at the tail, so those are kept as a count. Moving a snake is a
+    pushHead plus a popTail and growing is a pushTail of the current tail, all O(1) no matter
+    how long the snake is. Segments are read in order from the head by walking the links. The
+    ring is plain data of a few hundred bytes, so boards holding it copy with a memcpy.
+    */
+    class BodyRing {
+    public:
+        static constexpr int CAPACITY = 1024;
+        static_assert((CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+        static_assert(CAPACITY > MAX_CELLS, "capacity must cover the largest board");
+
+        //Walks the segments from the head
+        class Iterator {
+        public:
+            Iterator(const BodyRing& ring, int index): m_ring(&ring), m_cell(ring.m_head), m_index(index) {}
+            Cell operator*() const {return m_cell;}
+            Iterator& operator++() {
+                if (m_index < m_ring->links()) {
+                    m_cell = m_ring->m_table->step(m_cell, m_ring->link(m_index));
+                }
+                m_index++;
+                return *this;
+            }
+            bool operator!=(const Iterator& other) const {return m_index != other.m_index;}
+            //Position of the current segment counted from the head
+            int index() const {return m_index;}
+
+        private:
+            const BodyRing* m_ring;
+            Cell m_cell;
+            int m_index;
+        };
+
+        //Empties the ring, which then follows links through the given board's neighbors
+        void reset(const NeighborTable& table) {
+            m_table = &table;
+            m_first = 0;
+            m_size = 0;
+            m_stacked = 0;
+        }
+
+        int size() const {return m_size;}
+        bool empty() const {return m_size == 0;}
+        Cell head() const {return m_head;}
+        Cell tail() const {return m_tail;}
+        //Segments up to the tail's first copy; the rest are stacked on the tail
+        int distinct() const {return m_size - m_stacked;}
+        Iterator begin() const {return Iterator(*this, 0);}
+        Iterator end() const {return Iterator(*this, m_size);}
+
+        //c must be next to the head
+        void pushHead(Cell c) {
+            if (m_size == 0) {
+                m_head = m_tail = c;
+            } else {
+                m_first = (m_first - 1) & MASK;
+                setLink(0, m_table->directionTo(c, m_head));
+                m_head = c;
+            }
+            m_size++;
+        }
+        Cell popHead() {
+            const Cell c = m_head;
+            if (links() > 0) {
+                m_head = m_table->step(m_head, link(0));
+                m_first = (m_first + 1) & MASK;
+            } else if (m_stacked > 0) {
+                m_stacked--;
+            }
+            m_size--;
+            return c;
+        }
+        //c must be the tail, which stacks it, or next to the tail
+        void pushTail(Cell c) {
+            if (m_size == 0) {
+                m_head = m_tail = c;
+            } else if (c == m_tail) {
+                m_stacked++;
+            } else {
+                setLink(links(), m_table->directionTo(m_tail, c));
+                m_tail = c;
+            }
+            m_size++;
+        }
+        Cell popTail() {
+            const Cell c = m_tail;
+            if (m_stacked > 0) {
+                m_stacked--;
+            } else if (m_size > 1) {
+                m_tail = m_table->step(m_tail, opposite(link(links() - 1)));
+            }
+            m_size--;
+            return c;
+        }
+
+        //True when the last two segments share a cell, so the tail stays put next turn
+        bool tailStacked() const {
+            return m_stacked > 0;
+        }
+        //Index of the first of the first count segments equal to c, or -1
+        int find(Cell c, int count) const {
+            for (Iterator it = begin(); it.index() < count; ++it) {
+                if (*it == c) {
+                    return it.index();
+                }
+            }
+            return -1;
+        }
+        bool contains(Cell c) const {
+            return find(c, distinct()) != -1;
+        }
+        bool operator==(const BodyRing& other) const {
+            if (m_size != other.m_size || m_stacked != other.m_stacked || m_head != other.m_head) {
+                return false;
+            }
+            for (int i=0; i<links(); i++) {
+                if (link(i) != other.link(i)) {return false;}
+            }
+            return true;
+        }
+        bool operator!=(const BodyRing& other) const {return !(*this == other);}
+
+    private:
+        static constexpr int MASK = CAPACITY - 1;
+        static constexpr int LINKS_PER_WORD = 32;
+
+        int links() const {return m_size > 0 ? m_size - 1 - m_stacked : 0;}
+        //Direction from segment i to segment i + 1
+        Direction link(int i) const {
+            const int p = (m_first + i) & MASK;
+            return static_cast<Direction>(m_links[p / LINKS_PER_WORD] >> (p % LINKS_PER_WORD * 2) & 3);
+        }
+        void setLink(int i, Direction direction) {
+            const int p = (m_first + i) & MASK;
+            const int shift = p % LINKS_PER_WORD * 2;
+            uint64_t& word = m_links[p / LINKS_PER_WORD];
+            word = (word & ~(uint64_t{3} << shift)) | (static_cast<uint64_t>(direction) << shift);
+        }
+
+        const NeighborTable* m_table = nullptr;
+        std::array<uint64_t, CAPACITY / LINKS_PER_WORD> m_links;
+        int m_first = 0;
+        int m_size = 0;
+        int m_stacked = 0;
+        Cell m_head = NO_CELL;
+        Cell m_tail = NO_CELL;
+    };
+} // battlesnake
+
+#endif //BODY_RING_H
@@ -0,0 +1,76 @@
+#ifndef ENDGAME_H
+#define ENDGAME_H
+#include "rules.h"
+#include "search.h"
+#include <unordered_map>
+#include <vector>
+
+namespace battlesnake {
+    //Regions up to this many cells are solved exactly, a visited set fits one 32-bit mask
+    constexpr int MAX_SEALED_CELLS = 32;
+    //Each path search gives up after this many nodes and leave the position to the general search
+    constexpr uint64_t MAX_ENDGAME_NODES = 1 << 16;
+
+    struct EndgameResult {
+        bool proven = false;  //score is the result of the game with best play
+        bool solved = false;  //move is our best: the game is proven or we are sealed off alone
+        int score = 0;
+        Direction move = Direction::Up;
+        int turns = 0;        //Turns until the game is decided or, when only solved, until we die
+        uint64_t nodes = 0;
+    };
+
+    /*
+    Exact play once the snakes can no longer meet. A snake is sealed when the cells it could reach
+    before it must die form a small region no other snake can enter in that time: the region is
+    grown from the head through every cell that frees up within the snake's longest path in it,
+    until that path stops getting longer. Inside the region the snake's longest path is found
+    by a search memoized on (cell, visited set), with its own tail freeing up as it moves and
+    slowing down each time it eats. A path shorter than the snake never reaches a cell it left,
+    so the snake then survives exactly that many moves. A region closed off by another snake's
+    body only counts while that snake is itself sealed and lasts at least as long, since the
+    wall opens when it dies. Snakes in open space are only given a lower bound, by looking for a
+    path long enough to outlive the sealed ones.
+    */
+    class EndgameSolver {
+    public:
+        explicit EndgameSolver(const Rules& rules);
+
+        EndgameResult solve(const Board& board, int subject);
+
+    private:
+        struct Survival {
+            bool sealed = false;
+            int turns = 0;  //Moves the snake makes before it runs out of room
+            Direction move = Direction::Up;
+            Bitboard region;
+            uint32_t walls = 0;  //Bit per other snake whose body closes the region off
+        };
+
+        bool growRegion(int snake, int horizon, Bitboard& region) const;
+        int regionPath(int snake, const Bitboard& region, Direction& move);
+        void sealSnake(int snake, Survival& survival);
+        int longestPath(int local, uint32_t visited);
+        bool findPath(int snake, int target, const Bitboard& avoid, Direction& move);
+        bool extendPath(Cell cell, int moves, int eaten, int target);
+
+        Rules m_rules;
+        const Board* m_board = nullptr;
+        //Snake whose body holds each cell, -1 if none
+        std::array<int8_t, MAX_CELLS> m_owner;
+        uint64_t m_nodes = 0;
+        uint64_t m_node_limit = 0;
+        bool m_aborted = false;
+        //Region being solved, in local cell indices
+        std::vector<Cell> m_cells;
+        std::array<uint32_t, MAX_SEALED_CELLS> m_adjacent;
+        std::array<int, MAX_SEALED_CELLS> m_timers;
+        uint32_t m_food = 0;
+        std::unordered_map<uint64_t, int> m_memo;
+        //Path being extended by findPath
+        Bitboard m_visited;
+        Bitboard m_blocked;
+    };
+} // battlesnake
+
+#endif //ENDGAME_H
@@ -0,0 +1,34 @@
+#ifndef ENGINE_CONFIG_H
+#define ENGINE_CONFIG_H
+#include <cstddef>
+#include <string>
+
+namespace battlesnake {
+    enum class EngineMode {Heuristic, AlphaBeta, Mcts};
+    enum class RolloutMode {Random, Evaluation};
+    enum class MctsParallelism {Root, Tree};
+
+    //Engine options chosen at startup with --key=value command line arguments
+    struct EngineConfig {
+        EngineMode mode = EngineMode::AlphaBeta;
+        RolloutMode rollout = RolloutMode::Random;
+        MctsParallelism mcts_parallelism = MctsParallelism::Root;
+        size_t hash_mb = 64;  //Transposition table size, allocated once at startup
+        int threads = 0;      //Search threads per move, 0 uses every core
+        bool ponder = true;   //Keep searching between moves
+        int ponder_threads = 1;  //Threads a game ponders on, kept few since many games may be open
+        int maxn_snakes = 3;  //Alpha-beta mode searches max^n instead from this many living snakes, 0 never
+        //With more opponents than max_opponents, only the nearest that many within opponent_radius
+        //are searched in full and the rest play a default move; a radius of 0 searches them all
+        int opponent_radius = 8;
+        int max_opponents = 3;
+        int beam_below_ms = 100;  //Move budgets shorter than this are searched with beam search, 0 never
+
+        //Applies one "--key=value" option, throwing std::invalid_argument if it is not recognized
+        void parseOption(const std::string& option);
+        int searchThreads() const;
+        int ponderThreads() const;
+    };
+} // battlesnake
+
+#endif //ENGINE_CONFIG_H
@@ -0,0 +1,24 @@
+#ifndef EVALUATION_H
+#define EVALUATION_H
+#include "battlesnake.h"
+
+namespace battlesnake {
+    //Score of a decided game; search adds or subtracts the ply so quicker wins and slower losses rank higher
+    constexpr int WIN_SCORE = 1000000;
+    constexpr int INFINITE_SCORE = WIN_SCORE + 1000;
+
+    /*
+    Cells each living snake reaches strictly before every other snake, with bodies freeing up as
+    turns pass. Cells reached by several heads on the same turn belong to nobody.
+    */
+    std::array<int, MAX_SNAKES> voronoiTerritory(const Board& board);
+
+    //Static score of a position from subject's point of view, higher is better
+    int evaluate(const Board& board, int subject);
+    //evaluate() for every snake slot at once, sharing one territory computation
+    std::array<int, MAX_SNAKES> evaluateAll(const Board& board);
+    //Cheaper stand-in for evaluate() that counts the cells the snake reaches soon, ignoring rivals
+    int quickEvaluate(const Board& board, int subject);
+} // battlesnake
+
+#endif //EVALUATION_H
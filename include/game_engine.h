@@ -0,0 +1,82 @@
+#ifndef GAME_ENGINE_H
+#define GAME_ENGINE_H
+#include "battlesnake.h"
+#include "beam.h"
+#include "endgame.h"
+#include "maxn.h"
+#include "mcts.h"
+#include "rules.h"
+#include "search.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace battlesnake {
+    /*
+    Search state for one game, kept between /move requests. After we answer, the engine keeps
+    searching from the answered position with our move fixed (pondering) until the next request
+    arrives or the game ends, on a few threads of its own and only while no game is choosing a
+    move. The next request works out the joint move the snakes actually
+    played: when the new board follows from the answered one, the MCTS trees move down to the
+    matching child and carry on growing, and alpha-beta finds the pondered positions in the
+    shared transposition table. Snake slots stay those of the first position the engine saw.
+    In alpha-beta mode, positions with enough living snakes are searched with max^n instead.
+    Positions the endgame solver settles are answered without searching at all, and move budgets
+    too short for the full searches get a beam search.
+    */
+    class GameEngine {
+    public:
+        //Pondering gives up after this many move timeouts without a new request
+        static constexpr int PONDER_TIMEOUTS = 4;
+
+        /*
+        choosing counts the engines of every game that are choosing a move, which pondering makes
+        way for. The search arenas are sized for the game's number of snakes.
+        */
+        GameEngine(
+            const EngineConfig& config, const Rules& rules, TranspositionTable& table, std::atomic<int>& choosing,
+            int snakes
+        );
+        ~GameEngine();
+        GameEngine(const GameEngine&) = delete;
+        GameEngine& operator=(const GameEngine&) = delete;
+
+        //Searches until the deadline, a result of depth 0 means there was nothing to search
+        SearchResult chooseMove(const Board& board, const std::string& you_id, SearchClock::time_point deadline);
+        //Searches on in the background from the last answered position
+        void startPondering(int timeout_ms);
+
+    private:
+        std::optional<Board> followingBoard(const Board& current, JointMove& played) const;
+        bool prepareTrees(const Board& root, const JointMove* played);
+        bool usesMaxn(const Board& board) const;
+        bool usesBeam(SearchClock::time_point deadline) const;
+        OpponentFilter opponentFilter() const;
+        void ponder(SearchClock::time_point until);
+        void stopPondering();
+        PlayoutPolicy& policy();
+
+        EngineConfig m_config;
+        Rules m_rules;
+        TranspositionTable& m_table;
+        std::atomic<int>& m_choosing;
+        EndgameSolver m_endgame;
+        BeamSearch m_beam;
+        RandomRolloutPolicy m_random_rollout;
+        EvaluationPolicy m_evaluation;
+        std::vector<std::unique_ptr<MctsSearch>> m_trees;
+        std::unique_ptr<TreeParallelMcts> m_shared_tree;
+        //Last position we answered and the move we sent, in this engine's snake slots
+        std::optional<Board> m_root;
+        int m_subject = -1;
+        Direction m_our_move = Direction::Up;
+        std::mutex m_mutex;
+        std::thread m_ponder_thread;
+        std::atomic<bool> m_ponder_stop{false};
+    };
+} // battlesnake
+
+#endif //GAME_ENGINE_H
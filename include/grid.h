@@ -0,0 +1,61 @@
+#ifndef GRID_H
+#define GRID_H
+#include "bitboard.h"
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace battlesnake {
+    //Per-cell values sized for the largest board and indexed by cell, so copies never allocate
+    template<class T>
+    using CellArray = std::array<T, MAX_CELLS>;
+
+    /*
+    Row-major per-cell storage backed by a single allocation. Cells can be addressed either by
+    (x, y) or by their flat index y * width + x, which matches the bitboard cell indices.
+    */
+    template<class T>
+    class Grid {
+    public:
+        using reference = typename std::vector<T>::reference;
+        using const_reference = typename std::vector<T>::const_reference;
+
+        Grid() = default;
+        Grid(int width, int height, const T& value = T()):
+            m_width(width), m_height(height), m_cells(static_cast<size_t>(width * height), value) {
+        }
+
+        int width() const {return m_width;}
+        int height() const {return m_height;}
+        int size() const {return m_width * m_height;}
+        int index(int x, int y) const {return y * m_width + x;}
+
+        reference operator()(int x, int y) {
+            return m_cells[static_cast<size_t>(index(x, y))];
+        }
+        const_reference operator()(int x, int y) const {
+            return m_cells[static_cast<size_t>(index(x, y))];
+        }
+        reference operator[](int i) {
+            return m_cells[static_cast<size_t>(i)];
+        }
+        const_reference operator[](int i) const {
+            return m_cells[static_cast<size_t>(i)];
+        }
+
+        void fill(const T& value) {
+            std::fill(m_cells.begin(), m_cells.end(), value);
+        }
+        auto begin() {return m_cells.begin();}
+        auto end() {return m_cells.end();}
+        auto begin() const {return m_cells.begin();}
+        auto end() const {return m_cells.end();}
+
+    private:
+        int m_width = 0;
+        int m_height = 0;
+        std::vector<T> m_cells;
+    };
+} // battlesnake
+
+#endif //GRID_H
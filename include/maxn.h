@@ -0,0 +1,45 @@
+#ifndef MAXN_H
+#define MAXN_H
+#include "search.h"
+
+namespace battlesnake {
+    /*
+    Iterative-deepening max^n for games of three or more snakes. Each turn is searched as if the
+    living snakes chose one after another, us first, each seeing the earlier choices and
+    maximizing its own component of a value vector; the joint move is then played with
+    Rules::step and unwound with Rules::undo. Leaves split a value of 1 between the living snakes
+    by a softmax of their evaluations, so the components never sum to more than 1 and shallow
+    pruning applies: a snake stops trying moves once its best leaves the snake that chose before
+    it no more than that snake already has elsewhere.
+    */
+    class MaxnSearch {
+    public:
+        explicit MaxnSearch(const Rules& rules);
+
+        SearchResult search(const Board& root, int subject, const SearchLimits& limits);
+
+    private:
+        using Values = std::array<double, MAX_SNAKES>;
+
+        Values chooseNode(int depth, int ply, int mover, double bound);
+        Values leafValues() const;
+        bool timeUp();
+
+        Rules m_rules;
+        Board* m_board = nullptr;
+        int m_subject = 0;
+        SearchLimits m_limits;
+        uint64_t m_nodes = 0;
+        bool m_stopped = false;
+        //Best move found so far at the root, ours to play
+        Direction m_root_move = Direction::Up;
+        //Per ply: the joint move being built, each snake's candidate moves, the snakes choosing
+        //in order and how many there are
+        std::array<JointMove, MAX_SEARCH_PLY + 1> m_moves;
+        std::array<MoveMasks, MAX_SEARCH_PLY + 1> m_masks;
+        std::array<std::array<int8_t, MAX_SNAKES>, MAX_SEARCH_PLY + 1> m_order;
+        std::array<int, MAX_SEARCH_PLY + 1> m_movers;
+    };
+} // battlesnake
+
+#endif //MAXN_H
@@ -0,0 +1,211 @@
+#ifndef MCTS_H
+#define MCTS_H
+#include "movegen.h"
+#include "rng.h"
+#include "search.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace battlesnake {
+    //Per-snake outcome of a playout, each in [0, 1] where 1 is a win
+    using SnakeValues = std::array<double, MAX_SNAKES>;
+
+    //Scores a leaf of the tree for every snake; the board must be left as it was given
+    class PlayoutPolicy {
+    public:
+        virtual ~PlayoutPolicy() = default;
+        virtual SnakeValues evaluate(Board& board, const Rules& rules, Rng& rng) = 0;
+    };
+
+    //Maps the static evaluation of every snake into [0, 1] without playing any turns
+    class EvaluationPolicy: public PlayoutPolicy {
+    public:
+        SnakeValues evaluate(Board& board, const Rules& rules, Rng& rng) override;
+    };
+
+    //Plays up to a fixed number of turns with uniformly random legal moves, then evaluates
+    class RandomRolloutPolicy: public PlayoutPolicy {
+    public:
+        static constexpr int MAX_TURNS = 12;
+
+        SnakeValues evaluate(Board& board, const Rules& rules, Rng& rng) override;
+    };
+
+    //Visit and value totals of one snake's root moves, indexed by Direction
+    struct RootStats {
+        std::array<uint64_t, NUM_DIRECTIONS> visits{};
+        std::array<double, NUM_DIRECTIONS> value{};
+    };
+
+    //Fills in the values of a finished game, returns false while the game goes on
+    bool decidedValues(const Board& board, SnakeValues& values);
+
+    /*
+    Monte-Carlo tree search for simultaneous moves using decoupled UCT: at every node each snake
+    picks its own move by UCB1 over its own statistics, without seeing the others' choices, and
+    the resulting joint move selects the child. Leaves are scored by a pluggable PlayoutPolicy.
+    Nodes live in a preallocated arena and children are found through the joint move key; the
+    statistics arena has room for NUM_DIRECTIONS moves of each snake the tree is built for at
+    every node, so it never grows during a search.
+    The tree can outlive a search: adopt() moves the root down to the position actually reached
+    so the next search continues from the statistics already gathered there.
+    */
+    class MctsSearch {
+    public:
+        static constexpr size_t DEFAULT_MAX_NODES = 1 << 18;
+
+        MctsSearch(
+            const Rules& rules, PlayoutPolicy& policy, uint64_t seed, size_t max_nodes = DEFAULT_MAX_NODES,
+            int snakes = MAX_SNAKES
+        );
+
+        //Discards the tree and runs a new one from root
+        SearchResult search(const Board& root, int subject, const SearchLimits& limits);
+        //Keeps growing the current tree, whose root must be the given position
+        SearchResult run(const Board& root, int subject, const SearchLimits& limits);
+        void reset(const Board& root);
+        /*
+        Makes the child reached by the joint move the new root, compacting its subtree to the front
+        of the arena. Returns false when the tree never expanded that child.
+        */
+        bool adopt(const JointMove& moves);
+        //Only lets snake play move at the root, or lifts the restriction when snake is -1
+        void restrictRoot(int snake, Direction move = Direction::Up);
+        RootStats rootStats(int snake) const;
+
+    private:
+        static constexpr uint32_t NO_NODE = 0xFFFFFFFF;
+
+        struct MoveStats {
+            uint32_t visits = 0;
+            float value = 0;
+        };
+        struct PathStep {
+            uint32_t node;
+            std::array<uint8_t, MAX_SNAKES> choices;
+            UndoRecord record;
+        };
+        struct Node {
+            uint32_t first_child = NO_NODE;
+            uint32_t next_sibling = NO_NODE;
+            uint32_t joint_key = 0;  //Two bits per snake slot for the joint move leading here
+            uint32_t stats = 0;      //Offset of the node's MoveStats, one per move of each snake in slot order
+            uint32_t visits = 0;
+            std::array<MoveList, MAX_SNAKES> moves;
+        };
+
+        uint32_t newNode(const Board& board, uint32_t joint_key);
+        uint32_t findChild(uint32_t node, uint32_t joint_key) const;
+        void iterate(Board& board);
+        int selectMove(const Node& node, int snake) const;
+        uint32_t statsOffset(const Node& node, int snake) const;
+
+        Rules m_rules;
+        PlayoutPolicy& m_policy;
+        Rng m_rng;
+        size_t m_max_nodes;
+        size_t m_max_stats;
+        std::vector<Node> m_nodes;
+        std::vector<MoveStats> m_stats;
+        //Second arena the surviving subtree is copied into by adopt()
+        std::vector<Node> m_spare_nodes;
+        std::vector<MoveStats> m_spare_stats;
+        std::vector<PathStep> m_path;
+        int m_max_depth = 0;
+        int m_root_snake = -1;
+        Direction m_root_move = Direction::Up;
+    };
+
+    /*
+    Root-parallel MCTS: every thread grows its own private tree from the same root with its own
+    Rng, sharing nothing while it runs. At the deadline the root visit and value totals of all
+    trees are summed and the most visited move is played.
+    */
+    SearchResult rootParallelMctsSearch(
+        const Rules& rules, PlayoutPolicy& policy, const Board& root, int subject,
+        const SearchLimits& limits, int threads
+    );
+    //One tree per thread for runRootParallel, splitting the node budget between them
+    std::vector<std::unique_ptr<MctsSearch>> makeRootParallelTrees(
+        const Rules& rules, PlayoutPolicy& policy, int threads, int snakes = MAX_SNAKES
+    );
+    //Same, continuing existing trees whose roots are all the given position, the first threads of them or all
+    SearchResult runRootParallel(
+        std::vector<std::unique_ptr<MctsSearch>>& trees, const Board& root, int subject, const SearchLimits& limits,
+        int threads = 0
+    );
+
+    /*
+    Tree-parallel MCTS: all threads grow one shared decoupled-UCT tree. Visit counts and value
+    sums are atomics, and children are linked in with a compare-and-swap so expansion never
+    takes a lock. A thread counts its visit on the way down (virtual loss) and adds the value on
+    the way back, so threads descending at the same time spread over different branches. The
+    node and statistics arenas are allocated once, the statistics for up to NUM_DIRECTIONS moves
+    of each of the snakes the tree is built for at every node, so the node budget is what runs
+    out. reset(), adopt() and restrictRoot() work as in MctsSearch and must not be called while
+    a search is running.
+    */
+    class TreeParallelMcts {
+    public:
+        TreeParallelMcts(
+            const Rules& rules, PlayoutPolicy& policy, size_t max_nodes = MctsSearch::DEFAULT_MAX_NODES,
+            int snakes = MAX_SNAKES
+        );
+
+        SearchResult search(const Board& root, int subject, const SearchLimits& limits, int threads);
+        SearchResult run(const Board& root, int subject, const SearchLimits& limits, int threads);
+        void reset(const Board& root);
+        bool adopt(const JointMove& moves);
+        void restrictRoot(int snake, Direction move = Direction::Up);
+
+    private:
+        static constexpr uint32_t NO_NODE = 0xFFFFFFFF;
+
+        struct MoveStats {
+            std::atomic<uint32_t> visits;
+            std::atomic<float> value;
+        };
+        struct Node {
+            std::atomic<uint32_t> first_child;
+            uint32_t next_sibling;
+            uint32_t joint_key;
+            uint32_t stats;
+            std::atomic<uint32_t> visits;
+            std::array<MoveList, MAX_SNAKES> moves;
+        };
+        struct PathStep {
+            uint32_t node;
+            std::array<uint8_t, MAX_SNAKES> choices;
+            UndoRecord record;
+        };
+        //Per-thread scratch state
+        struct Worker {
+            Rng rng;
+            std::vector<PathStep> path;
+            uint64_t iterations = 0;
+            int max_depth = 0;
+        };
+
+        uint32_t newNode(const Board& board, uint32_t joint_key);
+        uint32_t findOrExpand(uint32_t parent, uint32_t joint_key, const Board& board, bool& expanded);
+        void iterate(Board& board, Worker& worker);
+        void work(const Board& root, const SearchLimits& limits, Worker& worker);
+        uint32_t statsOffset(const Node& node, int snake) const;
+
+        Rules m_rules;
+        PlayoutPolicy& m_policy;
+        size_t m_max_nodes;
+        size_t m_max_stats;
+        std::unique_ptr<Node[]> m_nodes;
+        std::unique_ptr<MoveStats[]> m_stats;
+        std::unique_ptr<Node[]> m_spare_nodes;
+        std::unique_ptr<MoveStats[]> m_spare_stats;
+        std::atomic<uint32_t> m_node_count{0};
+        std::atomic<uint32_t> m_stats_count{0};
+        int m_root_snake = -1;
+        Direction m_root_move = Direction::Up;
+    };
+} // battlesnake
+
+#endif //MCTS_H
@@ -0,0 +1,102 @@
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+#include "battlesnake.h"
+#include <algorithm>
+
+namespace battlesnake {
+    //One bit per Direction, set when that move is allowed
+    using MoveMask = uint8_t;
+    using MoveMasks = std::array<MoveMask, MAX_SNAKES>;
+
+    constexpr MoveMask directionBit(Direction direction) {
+        return static_cast<MoveMask>(1u << static_cast<int>(direction));
+    }
+
+    /*
+    Moves that stay on the board and avoid every body segment still in place next turn. Tails
+    about to move count as free, and bodies of other snakes on 1 health are ignored since they
+    starve unless they eat. Dead snakes get an empty mask.
+    */
+    MoveMask legalMoves(const Board& board, int snake);
+    MoveMasks legalMoveMasks(const Board& board);
+
+    //Cheap stand-in for a snake's own choice: the move leading to the most free neighbours, up if trapped
+    Direction defaultMove(const Board& board, int snake);
+
+    /*
+    Opponents worth searching once there are more than max_snakes of them: the max_snakes
+    nearest whose heads are within radius steps of the subject's. The others play their default
+    move, so a crowded board only branches for the snakes close enough to matter. A radius of 0
+    searches every snake.
+    */
+    struct OpponentFilter {
+        int radius = 0;
+        int max_snakes = 0;
+
+        //Legal moves of every snake, those left out held to their default move
+        MoveMasks masks(const Board& board, int subject) const;
+    };
+
+    //Candidate moves for one snake stored inline, best first
+    struct MoveList {
+        std::array<Direction, NUM_DIRECTIONS> moves;
+        uint8_t count = 0;
+
+        void push(Direction d) {moves[count++] = d;}
+        //Moves d to the front keeping the order of the rest, does nothing if d is not listed
+        void moveToFront(Direction d) {
+            for (int i=1; i<count; i++) {
+                if (moves[i] == d) {
+                    std::rotate(moves.begin(), moves.begin() + i, moves.begin() + i + 1);
+                    return;
+                }
+            }
+        }
+        Direction operator[](int i) const {return moves[i];}
+        const Direction* begin() const {return moves.data();}
+        const Direction* end() const {return moves.data() + count;}
+        bool empty() const {return count == 0;}
+        int size() const {return count;}
+    };
+
+    //True when another living snake's head is one or two steps from the snake's head
+    bool headsInContact(const Board& board, int snake);
+
+    /*
+    Orders a snake's legal moves so those that cannot be met by a head at least as long come
+    first. A snake with no legal move still gets one forced move so joint moves stay complete.
+    */
+    MoveList orderedMoves(const Board& board, int snake, MoveMask legal);
+
+    /*
+    Enumerates every combination of the living snakes' candidate moves, with suicidal moves
+    pruned up front. Snakes can be restricted to a single move with fix(), for example our
+    own move while iterating the replies to it.
+        for (JointMoveIterator it(board); !it.done(); it.next()) {board.applyJointMove(it.current());}
+    */
+    class JointMoveIterator {
+    public:
+        explicit JointMoveIterator(const Board& board);
+        JointMoveIterator(const Board& board, const MoveMasks& masks);
+
+        void fix(int snake, Direction move);
+        //Replaces a snake's candidate moves, for example with the same moves in a better order
+        void setMoves(int snake, const MoveList& moves);
+        const MoveList& moves(int snake) const {return m_moves[snake];}
+        const JointMove& current() const {return m_current;}
+        bool done() const {return m_done;}
+        void next();
+        //Number of joint moves the iterator produces in total
+        int count() const;
+        void reset();
+
+    private:
+        int m_snake_count;
+        std::array<MoveList, MAX_SNAKES> m_moves;
+        std::array<uint8_t, MAX_SNAKES> m_index;
+        JointMove m_current;
+        bool m_done = false;
+    };
+} // battlesnake
+
+#endif //MOVEGEN_H
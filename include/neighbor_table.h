@@ -0,0 +1,71 @@
+#ifndef NEIGHBOR_TABLE_H
+#define NEIGHBOR_TABLE_H
+#include "bitboard.h"
+#include <array>
+#include <cstdint>
+
+namespace battlesnake {
+    //Packed board position, y * width + x
+    using Cell = uint16_t;
+    constexpr Cell NO_CELL = 0xFFFF;
+
+    enum class Direction : uint8_t {Up, Down, Left, Right};
+    constexpr int NUM_DIRECTIONS = 4;
+
+    //Directions come in opposite pairs, so flipping the low bit reverses one
+    constexpr Direction opposite(Direction direction) {
+        return static_cast<Direction>(static_cast<int>(direction) ^ 1);
+    }
+
+    const char* directionName(Direction direction);
+
+    //Up to four neighboring cells, stored inline so iterating them never allocates
+    struct NeighborList {
+        std::array<Cell, NUM_DIRECTIONS> cells;
+        uint8_t count = 0;
+
+        void push(Cell c) {cells[count++] = c;}
+        bool contains(Cell c) const {
+            for (Cell n : *this) {
+                if (n == c) {return true;}
+            }
+            return false;
+        }
+        const Cell* begin() const {return cells.data();}
+        const Cell* end() const {return cells.data() + count;}
+        bool empty() const {return count == 0;}
+        int size() const {return count;}
+    };
+
+    /*
+    Neighbors of every cell, built once per board size. Each cell stores its in-bounds neighbors
+    in the order left, right, down, up, plus the destination of a step in each direction
+    (NO_CELL when that step leaves the board). Wrapped maps connect opposite edges.
+    */
+    class NeighborTable {
+    public:
+        NeighborTable(int width, int height, bool wrapped);
+
+        //Returns the shared table for this board size, building it on first use
+        static const NeighborTable& get(int width, int height, bool wrapped);
+
+        const NeighborList& neighbors(Cell c) const {return m_neighbors[c];}
+        Cell step(Cell c, Direction direction) const {
+            return m_steps[c][static_cast<int>(direction)];
+        }
+        //Direction that moves from one cell to an adjacent one
+        Direction directionTo(Cell from, Cell to) const;
+        int width() const {return m_width;}
+        int height() const {return m_height;}
+        bool wrapped() const {return m_wrapped;}
+
+    private:
+        int m_width;
+        int m_height;
+        bool m_wrapped;
+        std::array<NeighborList, MAX_CELLS> m_neighbors;
+        std::array<std::array<Cell, NUM_DIRECTIONS>, MAX_CELLS> m_steps;
+    };
+} // battlesnake
+
+#endif //NEIGHBOR_TABLE_H
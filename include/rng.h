@@ -0,0 +1,41 @@
+#ifndef RNG_H
+#define RNG_H
+#include <cstdint>
+#include <limits>
+#include <random>
+
+namespace battlesnake {
+    //SplitMix64 generator: tiny state, fast, and usable anywhere a UniformRandomBitGenerator is
+    class Rng {
+    public:
+        using result_type = uint64_t;
+
+        explicit Rng(uint64_t seed = 0x9E3779B97F4A7C15ULL): m_state(seed) {}
+
+        uint64_t next() {
+            uint64_t z = (m_state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+        //Uniform integer in [0, n)
+        int below(int n) {
+            return static_cast<int>(((next() >> 32) * static_cast<uint64_t>(n)) >> 32);
+        }
+
+        result_type operator()() {return next();}
+        static constexpr result_type min() {return 0;}
+        static constexpr result_type max() {return std::numeric_limits<result_type>::max();}
+
+    private:
+        uint64_t m_state;
+    };
+
+    //Generator private to the calling thread, seeded once from std::random_device
+    inline Rng& threadRng() {
+        thread_local Rng rng((uint64_t{std::random_device{}()} << 32) ^ std::random_device{}());
+        return rng;
+    }
+} // battlesnake
+
+#endif //RNG_H
@@ -0,0 +1,33 @@
+#ifndef RULES_H
+#define RULES_H
+#include "battlesnake.h"
+#include "rng.h"
+
+namespace battlesnake {
+    /*
+    One turn of the official standard ruleset played on a Board in place: snakes move, lose
+    health, take hazard damage, eat, food is placed, and snakes that starved, left the board,
+    hit a body or lost a head-to-head are eliminated. Every step can be reverted with undo().
+    */
+    class Rules {
+    public:
+        explicit Rules(const RulesetSettings& settings);
+        Rules(int food_spawn_chance, int minimum_food, int hazard_damage);
+
+        //Food is only placed when an Rng is given, so search can play turns deterministically
+        UndoRecord step(Board& board, const JointMove& moves, Rng* food_rng = nullptr) const;
+        void undo(Board& board, const UndoRecord& record) const;
+        int hazardDamage() const {return m_hazard_damage;}
+
+    private:
+        void damageHazards(Board& board, const UndoRecord& record) const;
+        void spawnFood(Board& board, Rng& rng, const Bitboard& blocked, UndoRecord& record) const;
+        uint32_t eliminateSnakes(Board& board) const;
+
+        int m_food_spawn_chance;
+        int m_minimum_food;
+        int m_hazard_damage;
+    };
+} // battlesnake
+
+#endif //RULES_H
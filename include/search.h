@@ -0,0 +1,125 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+#include "battlesnake.h"
+#include "rules.h"
+#include "timing.h"
+#include "transposition.h"
+#include "movegen.h"
+#include <atomic>
+#include <memory>
+#include <optional>
+
+namespace battlesnake {
+    //Deepest ply a search may reach, extensions included
+    constexpr int MAX_SEARCH_PLY = 128;
+    //Turns a single line may be extended by for heads in contact
+    constexpr int MAX_CONTACT_EXTENSIONS = 2;
+
+    struct SearchLimits {
+        SearchClock::time_point deadline;
+        int max_depth = 64;
+        const std::atomic<bool>* stop = nullptr;  //Lets another thread end the search early
+        const std::atomic<int>* yield = nullptr;  //Ends the search once this counts any other search running
+        OpponentFilter opponents;                 //Opponents modelled in full, by default all of them
+
+        //True once another thread asked the search to stop or to make way
+        bool stopSignalled() const {
+            return (stop != nullptr && stop->load(std::memory_order_relaxed))
+                || (yield != nullptr && yield->load(std::memory_order_relaxed) > 0);
+        }
+    };
+
+    struct SearchResult {
+        Direction move = Direction::Up;
+        int score = 0;
+        int depth = 0;  //Deepest fully searched iteration, 0 if none finished
+        uint64_t nodes = 0;
+    };
+
+    /*
+    History heuristic: for every snake, cell and direction, how often moving that way from that
+    cell caused a cutoff, weighted by the depth left. Orders moves the transposition table and
+    killers know nothing about.
+    */
+    class HistoryTable {
+    public:
+        HistoryTable();
+
+        int score(int snake, Cell from, Direction move) const {
+            return (*m_scores)[snake][from][static_cast<int>(move)];
+        }
+        void reward(int snake, Cell from, Direction move, int depth);
+        void clear();
+        //Sorts moves by descending history, keeping the current order among equal scores
+        void order(MoveList& moves, int snake, Cell from) const;
+
+    private:
+        //Scores are halved for the snake once one reaches this, so recent cutoffs keep counting
+        static constexpr int32_t MAX_SCORE = 1 << 24;
+        using Scores = std::array<std::array<std::array<int32_t, NUM_DIRECTIONS>, MAX_CELLS>, MAX_SNAKES>;
+
+        std::unique_ptr<Scores> m_scores;
+    };
+
+    /*
+    Iterative-deepening alpha-beta in paranoid mode: we choose a move, then every opponent
+    replies jointly to minimize our score. Depth counts whole turns played through Rules::step
+    and unwound with Rules::undo on a single board. An iteration cut short by the deadline is
+    thrown away, so the result always comes from the deepest iteration that finished.
+    Positions at our move nodes are cached in an optional shared TranspositionTable, keyed by
+    the board hash and the subject since paranoid scores are relative to it. Our moves
+    are tried hash move first, then the killer move of the ply, then by history; the opponents'
+    replies are ordered per snake by history with the ply's killer reply first.
+    Turns that leave our head within two steps of another head are searched a turn deeper
+    without using up depth, and such encounters left at the horizon are resolved from the
+    cells each head can reach rather than by the evaluation alone.
+    */
+    class AlphaBetaSearch {
+    public:
+        explicit AlphaBetaSearch(const Rules& rules, TranspositionTable* table = nullptr);
+
+        SearchResult search(const Board& root, int subject, const SearchLimits& limits);
+        //Helpers 1..N start at staggered depths and vary their move order, the main search is 0
+        void setHelper(int helper_id) {m_helper_id = helper_id;}
+
+    private:
+        int maxNode(int depth, int ply, int alpha, int beta);
+        int minNode(Direction our_move, int depth, int ply, int alpha, int beta);
+        bool isDecided(int ply, int& score) const;
+        int resolveContact(int ply) const;
+        bool timeUp();
+        void orderReplies(JointMoveIterator& replies, int ply) const;
+        void rewardReply(const JointMove& reply, int depth, int ply);
+
+        Rules m_rules;
+        TranspositionTable* m_table;
+        Board* m_board = nullptr;
+        int m_subject = 0;
+        uint64_t m_subject_key = 0;
+        bool m_solo = false;
+        SearchLimits m_limits;
+        uint64_t m_nodes = 0;
+        bool m_stopped = false;
+        int m_helper_id = 0;
+        //Contact extensions taken on the line being searched
+        int m_extensions = 0;
+        HistoryTable m_history;
+        //Our move and the opponents' joint reply that last caused a cutoff at each ply
+        std::array<std::optional<Direction>, MAX_SEARCH_PLY> m_killers;
+        std::array<std::optional<JointMove>, MAX_SEARCH_PLY> m_reply_killers;
+    };
+
+    /*
+    Lazy SMP: the calling thread and threads - 1 helpers run the same iterative deepening search
+    on the root, sharing only the transposition table. Helpers start at staggered depths with a
+    rotated move order, so they fill the table with different subtrees the others then reuse.
+    Once the main search stops, the helpers are stopped and the deepest finished result of any
+    thread is returned, preferring the main search on ties.
+    */
+    SearchResult lazySmpSearch(
+        const Rules& rules, TranspositionTable& table, const Board& root, int subject,
+        const SearchLimits& limits, int threads
+    );
+} // battlesnake
+
+#endif //SEARCH_H
@@ -0,0 +1,35 @@
+#ifndef TIMING_H
+#define TIMING_H
+#include <chrono>
+
+namespace battlesnake {
+    using SearchClock = std::chrono::steady_clock;
+
+    /*
+    Per-game move budget. The deadline is the request arrival time plus the game timeout, minus
+    the network overhead and a safety margin. Overhead is estimated from the latency the game
+    engine reports for our previous response, less the time we spent computing it. The estimate
+    rises at once on a slow round trip and only decays gradually, so one quiet turn does not
+    bring back a timeout.
+    */
+    class TimeManager {
+    public:
+        SearchClock::time_point deadline(SearchClock::time_point arrival, int timeout_ms) const;
+        //Feeds the latency the engine reported for our response to the previous turn
+        void observeLatency(int turn, int latency_ms);
+        void recordResponse(int turn, std::chrono::milliseconds compute_time);
+        int overheadEstimate() const {return static_cast<int>(m_overhead_ms);}
+
+    private:
+        double m_overhead_ms = DEFAULT_OVERHEAD_MS;
+        int m_last_turn = -1;
+        int m_last_compute_ms = 0;
+
+        static constexpr double DEFAULT_OVERHEAD_MS = 150;
+        static constexpr double OVERHEAD_DECAY = 0.2;
+        static constexpr int SAFETY_MARGIN_MS = 25;
+        static constexpr int MIN_BUDGET_MS = 10;
+    };
+} // battlesnake
+
+#endif //TIMING_H
@@ -0,0 +1,53 @@
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+#include "neighbor_table.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace battlesnake {
+    //How a stored score relates to the true value of the position
+    enum class Bound : uint8_t {None, Exact, Lower, Upper};
+
+    struct TTEntry {
+        int score = 0;
+        int depth = 0;
+        Bound bound = Bound::None;
+        Direction move = Direction::Up;
+    };
+
+    /*
+    Fixed-size hash table of search results shared by every search thread without locks. Each
+    16 byte slot holds the packed entry and the board hash XORed with it; a probe only accepts
+    the slot if XORing the two gives back its own hash, so an entry torn by a concurrent write
+    simply reads as a miss. The slot count is the largest power of two that fits the requested
+    size, and all memory is allocated and zeroed up front.
+    */
+    class TranspositionTable {
+    public:
+        static constexpr size_t DEFAULT_SIZE_MB = 64;
+
+        explicit TranspositionTable(size_t size_mb = DEFAULT_SIZE_MB);
+
+        bool probe(uint64_t hash, TTEntry& entry) const;
+        //Keeps an existing entry for the same position only if it was searched deeper
+        void store(uint64_t hash, int depth, int score, Bound bound, Direction move);
+        void clear();
+        size_t slots() const {return m_mask + 1;}
+
+    private:
+        struct Slot {
+            std::atomic<uint64_t> check;
+            std::atomic<uint64_t> data;
+        };
+        static_assert(sizeof(Slot) == 16, "transposition table slots must stay 16 bytes");
+
+        static uint64_t pack(const TTEntry& entry);
+        static TTEntry unpack(uint64_t data);
+
+        std::unique_ptr<Slot[]> m_slots;
+        uint64_t m_mask;
+    };
+} // battlesnake
+
+#endif //TRANSPOSITION_H
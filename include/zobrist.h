@@ -0,0 +1,55 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+#include "bitboard.h"
+#include "neighbor_table.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace battlesnake {
+    //Snakes are hashed per slot, so boards with more snakes than this are rejected
+    constexpr int MAX_SNAKES = 16;
+
+    /*
+    Random keys for Zobrist hashing a board. A position's hash is the XOR of the keys of every
+    body segment and head per snake slot, each snake's health bucket and length, and every food
+    and hazard cell, so applying a move only XORs out the keys that changed and XORs in the new
+    ones. The two keys of a stacked tail cancel out, which is why the length is keyed as well.
+    Searches whose scores depend on whose turn is searched XOR in that snake's subject key.
+    Keys come from a fixed seed and are identical across runs.
+    */
+    class Zobrist {
+    public:
+        static constexpr int HEALTH_BUCKET_SIZE = 8;
+        static constexpr int HEALTH_BUCKETS = 100 / HEALTH_BUCKET_SIZE + 1;
+
+        static const Zobrist& keys();
+
+        uint64_t body(int snake, Cell c) const {return m_body[snake][c];}
+        uint64_t head(int snake, Cell c) const {return m_head[snake][c];}
+        uint64_t health(int snake, int health) const {return m_health[snake][healthBucket(health)];}
+        uint64_t length(int snake, int length) const {return m_length[snake][std::min(length, MAX_CELLS)];}
+        uint64_t food(Cell c) const {return m_food[c];}
+        uint64_t hazard(Cell c) const {return m_hazard[c];}
+        uint64_t subject(int snake) const {return m_subject[snake];}
+
+        static int healthBucket(int health) {
+            if (health <= 0) {return 0;}
+            if (health >= 100) {return HEALTH_BUCKETS - 1;}
+            return health / HEALTH_BUCKET_SIZE;
+        }
+
+    private:
+        Zobrist();
+
+        std::array<std::array<uint64_t, MAX_CELLS>, MAX_SNAKES> m_body;
+        std::array<std::array<uint64_t, MAX_CELLS>, MAX_SNAKES> m_head;
+        std::array<std::array<uint64_t, HEALTH_BUCKETS>, MAX_SNAKES> m_health;
+        std::array<std::array<uint64_t, MAX_CELLS + 1>, MAX_SNAKES> m_length;
+        std::array<uint64_t, MAX_CELLS> m_food;
+        std::array<uint64_t, MAX_CELLS> m_hazard;
+        std::array<uint64_t, MAX_SNAKES> m_subject;
+    };
+} // battlesnake
+
+#endif //ZOBRIST_H
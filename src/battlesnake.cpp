@@ -3,15 +3,22 @@
 //
 
 #include "battlesnake.h"
+#include "game_engine.h"
+#include "movegen.h"
+#include "rng.h"
 
+#include <algorithm>
 #include <iostream>
 #include <utility>
 #include <iomanip>
+#include <optional>
 #include <queue>
 
 
 namespace battlesnake {
-    BattleSnake::BattleSnake() {
+    BattleSnake::BattleSnake(const EngineConfig& engine_config):
+        config(engine_config), transposition_table(engine_config.hash_mb)
+    {
         Info const i{};
         info = i;
     }
@@ -20,16 +27,97 @@ namespace battlesnake {
         return info.GetInfo();
     }
 
-    std::string BattleSnake::end() {
+    std::string BattleSnake::end(const json& state) {
+        std::shared_ptr<GameSession> session;
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex);
+            const auto found = sessions.find({state["game"]["id"].get<std::string>(), state["you"]["id"].get<std::string>()});
+            if (found != sessions.end()) {
+                session = std::move(found->second);
+                sessions.erase(found);
+            }
+        }
+        if (session) {
+            //Waits for a /move still running for this game, then stops pondering and frees the trees
+            std::lock_guard<std::mutex> lock(session->mutex);
+            session->engine.reset();
+        }
         return "End";
     }
 
-    std::string BattleSnake::make_move(const json& state) {
+    std::shared_ptr<BattleSnake::GameSession> BattleSnake::newSession(const GameState& state) {
+        auto session = std::make_shared<GameSession>();
+        if (config.mode != EngineMode::Heuristic) {
+            session->engine = std::make_unique<GameEngine>(
+                config, Rules(state.getRulesetSettings()), transposition_table, choosing_moves, state.getSnakeCount()
+            );
+        }
+        session->last_used = SearchClock::now();
+        return session;
+    }
+
+    /*
+    Takes the least recently used game out of a full map, called with sessions_mutex held. The
+    caller lets go of it only after releasing the lock, since freeing a game joins its ponder
+    thread; a /move still running for it keeps it alive until that request is answered.
+    */
+    std::shared_ptr<BattleSnake::GameSession> BattleSnake::evictSession() {
+        if (sessions.size() < MAX_SESSIONS) {return nullptr;}
+        const auto oldest = std::min_element(sessions.begin(), sessions.end(), [](const auto& a, const auto& b) {
+            return a.second->last_used < b.second->last_used;
+        });
+        std::shared_ptr<GameSession> evicted = std::move(oldest->second);
+        sessions.erase(oldest);
+        return evicted;
+    }
+
+    //Session of the game, started here if its /start was missed
+    std::shared_ptr<BattleSnake::GameSession> BattleSnake::findSession(const GameState& state) {
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex);
+            const auto found = sessions.find({state.getGameId(), state.getYouId()});
+            if (found != sessions.end()) {
+                found->second->last_used = SearchClock::now();
+                return found->second;
+            }
+        }
+        std::shared_ptr<GameSession> session = newSession(state);
+        //Declared before the lock guard so it is destroyed after the lock is released
+        std::shared_ptr<GameSession> evicted;
+        std::lock_guard<std::mutex> lock(sessions_mutex);
+        const SessionKey key{state.getGameId(), state.getYouId()};
+        if (sessions.find(key) == sessions.end()) {
+            evicted = evictSession();
+        }
+        return sessions.try_emplace(key, std::move(session)).first->second;
+    }
+
+    std::string BattleSnake::make_move(const json& state, SearchClock::time_point arrival) {
         //Print the state
         //std::cout << state.dump() << std::endl;
         auto const gameState = GameState(state);
+        const std::shared_ptr<GameSession> session = findSession(gameState);
+        std::lock_guard<std::mutex> session_lock(session->mutex);
+        const std::optional<CachedMove>& cached = session->last_move;
+        if (cached && cached->turn == gameState.getTurn() && cached->hash == gameState.getHash()
+            && cached->you_id == gameState.getYouId() && cached->board == state["board"]) {
+            std::cout << "Repeated request, reusing previous move" << std::endl;
+            return cached->response;
+        }
+        TimeManager& time_manager = session->time_manager;
+        time_manager.observeLatency(gameState.getTurn(), gameState.getMyLatency());
+        const SearchClock::time_point deadline = time_manager.deadline(arrival, gameState.getTimeout());
+        std::cout << "Move budget " << std::chrono::duration_cast<std::chrono::milliseconds>(deadline - arrival).count()
+                  << " ms, network overhead estimate " << time_manager.overheadEstimate() << " ms" << std::endl;
         //Get my next move
-        std::string my_move = gameState.getMyMove();
+        std::string my_move = gameState.getMyMove(deadline, session->engine.get());
+        if (session->engine && config.ponder) {
+            session->engine->startPondering(gameState.getTimeout());
+        }
+        time_manager.recordResponse(
+            gameState.getTurn(),
+            std::chrono::duration_cast<std::chrono::milliseconds>(SearchClock::now() - arrival)
+        );
 
         
         // Create response object
@@ -37,10 +125,26 @@ namespace battlesnake {
         response["move"] = my_move;
         response["shout"] = "I'm walkin here!";
 
-        return response.dump();
+        std::string response_str = response.dump();
+        session->last_move = CachedMove{gameState.getTurn(), gameState.getHash(), gameState.getYouId(), state["board"], response_str};
+        return response_str;
     }
 
-    std::string BattleSnake::start() {
+    //Sets up the game's session ahead of the first move, so its search arenas are allocated off the clock
+    std::string BattleSnake::start(const json& state) {
+        const GameState gameState(state);
+        std::shared_ptr<GameSession> session = newSession(gameState);
+        //Both released after the lock: the evicted game and any session a repeated /start replaces
+        std::shared_ptr<GameSession> evicted;
+        std::lock_guard<std::mutex> lock(sessions_mutex);
+        const SessionKey key{gameState.getGameId(), gameState.getYouId()};
+        const auto found = sessions.find(key);
+        if (found == sessions.end()) {
+            evicted = evictSession();
+            sessions.emplace(key, std::move(session));
+        } else {
+            evicted = std::exchange(found->second, std::move(session));
+        }
         return "";
     }
 
@@ -50,78 +154,387 @@ namespace battlesnake {
     Coord::Coord(int xcoord, int ycoord): x(xcoord), y(ycoord) {
     }
 
-    Board::Board(const json& board): m_height(board["height"]), m_width(board["width"]) {
+    //Reads a board dimension, rejecting sizes the fixed width bitboards cannot hold
+    static int boardDimension(const json& board, const char* key) {
+        int dim = board[key];
+        if (dim < 1 || dim > MAX_BOARD_DIM) {
+            throw std::invalid_argument("Unsupported board size");
+        }
+        return dim;
+    }
+
+    BoardState::BoardState(int width, int height, bool wrapped):
+        m_height(height),
+        m_width(width),
+        m_neighbor_table(&NeighborTable::get(width, height, wrapped)),
+        m_geometry(width, height, wrapped),
+        m_hash(0)
+    {
+        //Create obstacles and heads arrays for faster retrievals in algorithms
+        m_heads_array.fill(0);
+        m_obstacles_array.fill(0);
+        m_occupancy.fill(0);
+    }
+
+    Board::Board(const json& board, bool wrapped):
+        BoardState(boardDimension(board, "width"), boardDimension(board, "height"), wrapped)
+    {
         for (const auto &hazard_coordinates: board["hazards"]) {
-            m_hazards.emplace_back(hazard_coordinates);
+            m_hazard_bits.set(toCell(Coord(hazard_coordinates)));
         }
-        m_food_array = std::vector<std::vector<bool>>(m_height, std::vector<bool>(m_width, false));
         for (const auto &food_coordinates: board["food"]) {
-            Coord new_food = Coord(food_coordinates);
-            m_food.push_back(new_food);
-            m_food_array[new_food.y][new_food.x] = true;
+            m_food_bits.set(toCell(Coord(food_coordinates)));
         }
-        //Create obstacles, heads, and food array for faster retrievals in algorithms
-        m_obstacles_array = std::vector<std::vector<int>>(m_height, std::vector<int>(m_width, 0));
-        m_heads_array = std::vector<std::vector<int>>(m_height, std::vector<int>(m_width, 0));
+        if (board["snakes"].size() > MAX_SNAKES) {
+            throw std::invalid_argument("Too many snakes");
+        }
+        auto snake_info = std::make_shared<std::vector<SnakeInfo>>();
         for (const auto &snake: board["snakes"]) {
-            Board::Snake new_snake = Board::Snake(snake);
-            m_snakes.push_back(new_snake);
-            m_heads_array[new_snake.m_head.y][new_snake.m_head.x] = new_snake.m_length;
-            for (int i=0; i<new_snake.m_length; i++) {
-                //Stop if the rest of the body is in the same place
-                if (new_snake.m_body[i] == new_snake.m_body[i-1]) {
-                    break;
+            //Slot index is the interned snake ID from here on
+            const int slot = m_snakes.count++;
+            snake_info->emplace_back(snake);
+            BodyRing& body = m_snakes.bodies[slot];
+            body.reset(*m_neighbor_table);
+            for (const auto &snake_body: snake["body"]) {
+                if (body.size() == BodyRing::CAPACITY) {
+                    throw std::invalid_argument("Snake body too long");
+                }
+                const Cell c = toCell(Coord(snake_body));
+                //Segments only ever share a cell at the tail
+                if (!body.empty() && c != body.tail()
+                    && (body.tailStacked() || !getNeighbors(body.tail()).contains(c))) {
+                    throw std::invalid_argument("Snake body is not contiguous");
                 }
+                body.pushTail(c);
+            }
+            const int length = snake["length"];
+            m_snakes.heads[slot] = toCell(Coord(snake["head"]));
+            m_snakes.health[slot] = snake["health"];
+            m_snakes.lengths[slot] = length;
+            m_snakes.alive[slot] = true;
+
+            m_heads_array[m_snakes.heads[slot]] = length;
+            m_head_bits.set(m_snakes.heads[slot]);
+            for (Cell c : body) {
+                m_occupancy[c]++;
+                m_occupied_bits.set(c);
+            }
+            //Segments stacked on the tail leave with it
+            for (BodyRing::Iterator it = body.begin(); it.index() < body.distinct(); ++it) {
                 //Distance to tail minus one is the optimistic number of turns until this space can be moved into
-                m_obstacles_array[new_snake.m_body[i].y][new_snake.m_body[i].x] = new_snake.m_length - (i+1);
+                m_obstacles_array[*it] = length - (it.index() + 1);
             }
         }
+        m_snake_info = std::move(snake_info);
+        m_hash = computeHash();
     }
 
-    //Returns all adjacent positions which are in-bounds
-    std::vector<Coord> Board::getNeighbors(const Coord& pos) const {
-        std::vector<Coord> neighbors;
-        if (pos.x > 0) {
-            neighbors.emplace_back(pos.x - 1, pos.y);
+    //Bucket cells by the turn they free up, then accumulate so each mask includes earlier ones
+    void Board::rebuildFreeMasks() const {
+        const int cells = m_width * m_height;
+        int max_timer = 0;
+        for (int i=0; i<cells; i++) {
+            max_timer = std::max(max_timer, obstacleTimer(static_cast<Cell>(i)));
         }
-        if (pos.x < m_width - 1) {
-            neighbors.emplace_back(pos.x + 1, pos.y);
+        m_free_after_count = std::min(max_timer + 2, FREE_MASKS);
+        std::fill_n(m_free_after.begin(), m_free_after_count, Bitboard());
+        for (int i=0; i<cells; i++) {
+            const int t = obstacleTimer(static_cast<Cell>(i)) + 1;
+            if (t < m_free_after_count) {
+                m_free_after[t].set(i);
+            }
         }
-        if (pos.y > 0) {
-            neighbors.emplace_back(pos.x, pos.y - 1);
+        for (int t=1; t<m_free_after_count; t++) {
+            m_free_after[t] |= m_free_after[t-1];
         }
-        if (pos.y < m_height - 1) {
-            neighbors.emplace_back(pos.x, pos.y + 1);
+        m_free_after_valid = true;
+    }
+
+    /*
+    Moves every living snake one step in its direction: tails advance, heads step forward and
+    lose one health, and snakes landing on food eat it, growing by one and resetting to full
+    health. Bodies, heads, food, obstacle timers and the hash are all updated in place, with
+    nothing allocated. Moves must stay on the board. Pass the returned record to undo().
+    */
+    UndoRecord Board::applyJointMove(const JointMove& moves) {
+        const Zobrist& keys = Zobrist::keys();
+        UndoRecord record;
+        record.hash = m_hash;
+        //Tails move first, so a head may follow any tail into its cell
+        for (int s=0; s<m_snakes.count; s++) {
+            if (!m_snakes.alive[s]) {continue;}
+            record.moved |= 1u << s;
+            const Cell tail = m_snakes.bodies[s].popTail();
+            record.tails[s] = tail;
+            m_hash ^= keys.body(s, tail);
+            if (--m_occupancy[tail] == 0) {
+                m_occupied_bits.reset(tail);
+            }
+        }
+        //Clear every old head before placing new ones so snakes that swap cells stay consistent
+        for (int s=0; s<m_snakes.count; s++) {
+            if (!(record.moved >> s & 1)) {continue;}
+            m_head_bits.reset(m_snakes.heads[s]);
+            m_heads_array[m_snakes.heads[s]] = 0;
         }
-        return neighbors;
+        m_ply++;
+        for (int s=0; s<m_snakes.count; s++) {
+            if (!(record.moved >> s & 1)) {continue;}
+            const Cell old_head = m_snakes.heads[s];
+            const Cell new_head = m_neighbor_table->step(old_head, moves[s]);
+            assert(new_head != NO_CELL);
+            BodyRing& body = m_snakes.bodies[s];
+            body.pushHead(new_head);
+            m_snakes.heads[s] = new_head;
+            m_hash ^= keys.head(s, old_head) ^ keys.head(s, new_head) ^ keys.body(s, new_head);
+            //An empty cell may still hold a stale timer from a removed snake
+            record.head_free_at[s] = m_obstacles_array[new_head];
+            const int free_at = m_occupancy[new_head] > 0 ? m_obstacles_array[new_head] : 0;
+            m_obstacles_array[new_head] = std::max(free_at, m_ply + m_snakes.lengths[s] - 1);
+            m_occupancy[new_head]++;
+            m_occupied_bits.set(new_head);
+            m_head_bits.set(new_head);
+            m_heads_array[new_head] = m_snakes.lengths[s];
+            record.health[s] = m_snakes.health[s];
+            m_hash ^= keys.health(s, m_snakes.health[s]) ^ keys.health(s, m_snakes.health[s] - 1);
+            m_snakes.health[s]--;
+        }
+        for (int s=0; s<m_snakes.count; s++) {
+            if (!(record.moved >> s & 1) || !m_food_bits.test(m_snakes.heads[s])) {continue;}
+            record.ate |= 1u << s;
+            m_hash ^= keys.health(s, m_snakes.health[s]) ^ keys.health(s, 100);
+            m_snakes.health[s] = 100;
+            //Growing stacks the tail, which keeps every segment in place one turn longer
+            BodyRing& body = m_snakes.bodies[s];
+            for (BodyRing::Iterator it = body.begin(); it.index() < body.distinct(); ++it) {
+                m_obstacles_array[*it]++;
+            }
+            const Cell tail = body.tail();
+            body.pushTail(tail);
+            m_occupancy[tail]++;
+            m_hash ^= keys.body(s, tail) ^ keys.length(s, m_snakes.lengths[s]) ^ keys.length(s, m_snakes.lengths[s] + 1);
+            m_snakes.lengths[s]++;
+            m_heads_array[m_snakes.heads[s]] = m_snakes.lengths[s];
+        }
+        //Food is removed after every snake has had the chance to eat it
+        for (int s=0; s<m_snakes.count; s++) {
+            const Cell head = m_snakes.heads[s];
+            if ((record.ate >> s & 1) && m_food_bits.test(head)) {
+                m_food_bits.reset(head);
+                m_hash ^= keys.food(head);
+            }
+        }
+        m_free_after_valid = false;
+        return record;
     }
 
-    //Returns 2d vector of bools for all board positions, true when likely lethal to move into
-    std::vector<std::vector<int>> Board::getObstacles() const {
-        return m_obstacles_array;
+    //Reverts the applyJointMove call that produced record; records must be undone newest first
+    void Board::undo(const UndoRecord& record) {
+        for (int s=m_snakes.count-1; s>=0; s--) {
+            if (!(record.ate >> s & 1)) {continue;}
+            BodyRing& body = m_snakes.bodies[s];
+            const Cell tail = body.popTail();
+            m_occupancy[tail]--;
+            m_snakes.lengths[s]--;
+            for (BodyRing::Iterator it = body.begin(); it.index() < body.distinct(); ++it) {
+                m_obstacles_array[*it]--;
+            }
+            m_food_bits.set(m_snakes.heads[s]);
+        }
+        for (int s=m_snakes.count-1; s>=0; s--) {
+            if (!(record.moved >> s & 1)) {continue;}
+            const Cell new_head = m_snakes.bodies[s].popHead();
+            m_obstacles_array[new_head] = record.head_free_at[s];
+            if (--m_occupancy[new_head] == 0) {
+                m_occupied_bits.reset(new_head);
+            }
+            m_head_bits.reset(new_head);
+            m_heads_array[new_head] = 0;
+            m_snakes.health[s] = record.health[s];
+        }
+        m_ply--;
+        //Same order as applyJointMove, so a cell shared by several heads ends up with the same length
+        for (int s=0; s<m_snakes.count; s++) {
+            if (!(record.moved >> s & 1)) {continue;}
+            BodyRing& body = m_snakes.bodies[s];
+            body.pushTail(record.tails[s]);
+            m_occupancy[record.tails[s]]++;
+            m_occupied_bits.set(record.tails[s]);
+            m_snakes.heads[s] = body.head();
+            m_head_bits.set(body.head());
+            m_heads_array[body.head()] = m_snakes.lengths[s];
+        }
+        m_hash = record.hash;
+        m_free_after_valid = false;
     }
 
-    //Returns 2d vector of bools for all food positions
-    std::vector<std::vector<bool>> Board::getFood() const {
-        return m_food_array;
+    //Ply at which a cell frees up, from the living bodies covering it; 0 when none does
+    int Board::bodyFreeAt(Cell c) const {
+        int free_at = 0;
+        for (int s=0; s<m_snakes.count; s++) {
+            if (!m_snakes.alive[s]) {continue;}
+            const int i = m_snakes.bodies[s].find(c, m_snakes.bodies[s].size());
+            if (i != -1) {
+                free_at = std::max(free_at, m_ply + m_snakes.lengths[s] - 1 - i);
+            }
+        }
+        return free_at;
+    }
+
+    /*
+    Takes an eliminated snake off the board; its body stays in the store so restoreSnake can put
+    it back. A cell it shares with a living body, where its head hit that body, gets that body's
+    timer back instead of the larger one the head left there.
+    */
+    void Board::removeSnake(int snake) {
+        const Zobrist& keys = Zobrist::keys();
+        const BodyRing& body = m_snakes.bodies[snake];
+        m_snakes.alive[snake] = false;
+        for (Cell c : body) {
+            m_hash ^= keys.body(snake, c);
+            if (--m_occupancy[c] == 0) {
+                m_occupied_bits.reset(c);
+            } else {
+                m_obstacles_array[c] = bodyFreeAt(c);
+            }
+        }
+        const Cell head = m_snakes.heads[snake];
+        m_hash ^= keys.head(snake, head) ^ keys.health(snake, m_snakes.health[snake]) ^ keys.length(snake, m_snakes.lengths[snake]);
+        m_head_bits.reset(head);
+        m_heads_array[head] = 0;
+        //Another snake may have moved its head into the same cell
+        for (int s=0; s<m_snakes.count; s++) {
+            if (m_snakes.alive[s] && m_snakes.heads[s] == head) {
+                m_head_bits.set(head);
+                m_heads_array[head] = m_snakes.lengths[s];
+            }
+        }
+        m_free_after_valid = false;
+    }
+
+    void Board::restoreSnake(int snake) {
+        const Zobrist& keys = Zobrist::keys();
+        const BodyRing& body = m_snakes.bodies[snake];
+        m_snakes.alive[snake] = true;
+        for (Cell c : body) {
+            m_hash ^= keys.body(snake, c);
+            if (m_occupancy[c]++ > 0) {
+                m_obstacles_array[c] = bodyFreeAt(c);
+            }
+            m_occupied_bits.set(c);
+        }
+        const Cell head = m_snakes.heads[snake];
+        m_hash ^= keys.head(snake, head) ^ keys.health(snake, m_snakes.health[snake]) ^ keys.length(snake, m_snakes.lengths[snake]);
+        m_head_bits.set(head);
+        m_heads_array[head] = m_snakes.lengths[snake];
+        m_free_after_valid = false;
     }
 
-    std::vector<std::vector<int>> Board::getHeadsArray() const {
+    int Board::aliveCount() const {
+        int alive = 0;
+        for (int s=0; s<m_snakes.count; s++) {
+            alive += m_snakes.alive[s];
+        }
+        return alive;
+    }
+
+    //Hashes the whole position from scratch; moves keep m_hash current by XORing only what changed
+    uint64_t Board::computeHash() const {
+        const Zobrist& keys = Zobrist::keys();
+        uint64_t hash = 0;
+        for (int s=0; s<m_snakes.count; s++) {
+            if (!m_snakes.alive[s]) {continue;}
+            const BodyRing& body = m_snakes.bodies[s];
+            for (Cell c : body) {
+                hash ^= keys.body(s, c);
+            }
+            hash ^= keys.head(s, m_snakes.heads[s]);
+            hash ^= keys.health(s, m_snakes.health[s]);
+            hash ^= keys.length(s, m_snakes.lengths[s]);
+        }
+        m_food_bits.forEach([&](int c) {hash ^= keys.food(static_cast<Cell>(c));});
+        m_hazard_bits.forEach([&](int c) {hash ^= keys.hazard(static_cast<Cell>(c));});
+        return hash;
+    }
+
+    void Board::copyItems(const Board& other) {
+        const Zobrist& keys = Zobrist::keys();
+        (m_food_bits ^ other.m_food_bits).forEach([&](int c) {m_hash ^= keys.food(static_cast<Cell>(c));});
+        (m_hazard_bits ^ other.m_hazard_bits).forEach([&](int c) {m_hash ^= keys.hazard(static_cast<Cell>(c));});
+        m_food_bits = other.m_food_bits;
+        m_hazard_bits = other.m_hazard_bits;
+    }
+
+    //Returns all adjacent positions which are in-bounds, or wrap around on wrapped maps
+    const NeighborList& Board::getNeighbors(Cell pos) const {
+        return m_neighbor_table->neighbors(pos);
+    }
+
+    //Returns grid of turns until each board position can be moved into
+    Grid<int> Board::getObstacles() const {
+        Grid<int> obstacles(m_width, m_height, 0);
+        for (int i=0; i<obstacles.size(); i++) {
+            obstacles[i] = obstacleTimer(static_cast<Cell>(i));
+        }
+        return obstacles;
+    }
+
+    //Returns grid of bools for all food positions
+    Grid<bool> Board::getFood() const {
+        Grid<bool> food_array(m_width, m_height, false);
+        m_food_bits.forEach([&](int c) {food_array[c] = true;});
+        return food_array;
+    }
+
+    const CellArray<int>& Board::getHeadsArray() const {
         return m_heads_array;
     }
 
+    //Returns the cells that can be moved into sim_time turns from now
+    Bitboard Board::freeAfter(int turns) const {
+        if (!m_free_after_valid) {
+            rebuildFreeMasks();
+        }
+        if (turns < 0) {
+            turns = 0;
+        }
+        //Once every timer has run out the last mask holds; otherwise look past the cached turns
+        if (turns < m_free_after_count || m_free_after_count < FREE_MASKS) {
+            return m_free_after[std::min(turns, m_free_after_count - 1)];
+        }
+        Bitboard free_cells = m_geometry.all();
+        m_occupied_bits.forEach([&](int c) {
+            if (obstacleTimer(static_cast<Cell>(c)) >= turns) {
+                free_cells.reset(c);
+            }
+        });
+        return free_cells;
+    }
+
     //Simulates available movement options from a given position, sim_turns in the future
-    std::vector<Coord> Board::simulateOptions(const Coord& pos, const int& sim_time) const {
-        std::vector<Coord> neighbors = getNeighbors(pos);
-        std::vector<Coord> safe;
-        for (Coord c : neighbors) {
-            if (sim_time > m_obstacles_array[c.y][c.x]) {
-                safe.push_back(c);
+    NeighborList Board::simulateOptions(Cell pos, int sim_time) const {
+        const Bitboard free_cells = freeAfter(sim_time);
+        NeighborList safe;
+        for (Cell c : m_neighbor_table->neighbors(pos)) {
+            if (free_cells.test(c)) {
+                safe.push(c);
             }
         }
         return safe;
     }
 
+    //Counts the cells reachable from start within max_turns moves, letting bodies free up as turns pass
+    int Board::floodFill(const Coord& start, int max_turns) const {
+        Bitboard reached;
+        reached.set(toCell(start));
+        Bitboard frontier = reached;
+        for (int t=1; t<=max_turns && frontier.any(); t++) {
+            frontier = m_geometry.neighbors(frontier).andNot(reached) & freeAfter(t);
+            reached |= frontier;
+        }
+        return reached.count();
+    }
+
     /*
     Uses an optimistic or pesimistic DFS search to find the longest possible path from the starting position.
     If avoid_heads is true and p_head_threats is provided then it will do a pesimistic search that assumes
@@ -130,52 +543,46 @@ namespace battlesnake {
     */
     int Board::measureVolume(
         const Coord& start, const int& subject_length, bool avoid_heads, 
-        const std::vector<std::vector<int>>* p_head_threats
+        const Grid<int>* p_head_threats
     ) const {
         int volume = 0;
-        std::vector<Coord> frontier_heads = {start};
-        std::vector<std::vector<Coord>> frontier_paths = {{start}};
-        std::vector<std::vector<int>> visited = std::vector<std::vector<int>>(
-            m_height, std::vector<int>(m_width, 0)
-        );
+        //Each frontier node carries its path as a bitboard so self intersection is a single bit test
+        std::vector<VolumeFrontierNode> frontier;
+        const Cell start_cell = toCell(start);
+        frontier.push_back({start_cell, Bitboard(), 1});
+        frontier.back().path.set(start_cell);
+        Grid<int> visited(m_width, m_height, 0);
         while (volume <= subject_length) {
-            if (frontier_heads.empty()) {
+            if (frontier.empty()) {
                 return volume;
             }
-            Coord next_pos = frontier_heads.back();
-            frontier_heads.pop_back();
-            std::vector<Coord> cur_path = frontier_paths.back();
-            frontier_paths.pop_back();
-            int cur_path_length = static_cast<int>(cur_path.size());
+            VolumeFrontierNode cur_node = frontier.back();
+            frontier.pop_back();
+            int cur_path_length = cur_node.length;
             if (cur_path_length > volume) {
                 volume = cur_path_length;
             }
-            std::vector<Coord> to_expand = simulateOptions(next_pos, cur_path_length);
-            for (Coord c : to_expand) {
+            const NeighborList to_expand = simulateOptions(cur_node.head, cur_path_length);
+            const Bitboard cur_path = cur_node.path;
+            for (Cell c_index : to_expand) {
                 //Check if this path intersects itself to soon
-                bool self_intersect = false;
-                for (int i=0; i<cur_path_length; i++) {
-                    if (c == cur_path[i] && (cur_path_length - i) <= (subject_length)) {
-                        self_intersect = true;
-                    }
-                }
-                if (self_intersect) {
+                if (cur_path.test(c_index)) {
                     continue;
                 }
                 //Avoid if another snake could get here first
                 if (avoid_heads){
                     const auto& head_threats = *p_head_threats;
-                    if (head_threats[c.y][c.x] <= cur_path_length+1){
+                    if (head_threats[c_index] <= cur_path_length+1){
                         continue;
                     }
                 }
                 //Check if this is longest path found to this point
-                if (cur_path_length+1 > visited[c.y][c.x]) {
+                if (cur_path_length+1 > visited[c_index]) {
                     //Mark visited and expand
-                    visited[c.y][c.x] = cur_path_length + 1;
-                    cur_path.push_back(c);
-                    frontier_heads.push_back(c);
-                    frontier_paths.push_back(cur_path);
+                    visited[c_index] = cur_path_length + 1;
+                    cur_node.path.set(c_index);
+                    cur_node.length++;
+                    frontier.push_back({c_index, cur_node.path, cur_node.length});
                 }
             }
         }
@@ -192,12 +599,10 @@ namespace battlesnake {
         std::priority_queue<AStarFrontierNode, std::vector<AStarFrontierNode>, std::greater<AStarFrontierNode>> frontier;
         frontier.push({
             {start_pos},
-            m_food_array[start_pos.y][start_pos.x] ? 1 : 0,
+            m_food_bits.test(toCell(start_pos)) ? 1 : 0,
             manDist(start_pos, end_pos)
         });
-        std::vector<std::vector<size_t>> explored(
-            m_height, std::vector<size_t>(m_width, std::numeric_limits<size_t>::max())
-        );
+        Grid<size_t> explored(m_width, m_height, std::numeric_limits<size_t>::max());
         while (!frontier.empty()) {
             //Pop next position to explore from frontier
             AStarFrontierNode cur_node = frontier.top();
@@ -210,15 +615,17 @@ namespace battlesnake {
                 return cur_node.path;
             }
             //If position from a longer path, explore it
-            if (explored[cur_pos.y][cur_pos.x] > cur_node.path.size()) {
-                explored[cur_pos.y][cur_pos.x] =  cur_node.path.size();
-                std::vector<Coord> to_expand = simulateOptions(cur_pos, cur_node.path.size());
-                for (Coord c : to_expand) {
+            const Cell cur_index = toCell(cur_pos);
+            if (explored[cur_index] > cur_node.path.size()) {
+                explored[cur_index] =  cur_node.path.size();
+                const NeighborList to_expand = simulateOptions(cur_index, static_cast<int>(cur_node.path.size()));
+                for (Cell c_index : to_expand) {
+                    const Coord c = toCoord(c_index);
                     std::vector<Coord> new_path = cur_node.path;
                     new_path.push_back(c);
                     frontier.push({
                         new_path,
-                        m_food_array[c.y][c.x] ? cur_node.food_count+1 : cur_node.food_count,
+                        m_food_bits.test(c_index) ? cur_node.food_count+1 : cur_node.food_count,
                         manDist(c, end_pos)
                     });
                 }
@@ -231,11 +638,12 @@ namespace battlesnake {
     //Returns distance of nearest food to pos using A* pathfinding, or -1 if no path found
     int Board::getFoodDist(const Coord& pos) const {
         size_t shortest_dist = std::numeric_limits<size_t>::max();
-        for (const Coord& food_pos : m_food) {
+        m_food_bits.forEach([&](int food_cell) {
+            const Coord food_pos = toCoord(static_cast<Cell>(food_cell));
             //Manhattan distance is a lower bound on A* distance
             size_t man_dist_size = static_cast<size_t>(manDist(pos, food_pos));
             if (man_dist_size > shortest_dist) {
-                continue;
+                return;
             }
             std::vector<Coord> path = aStar(pos, food_pos);
             if (!path.empty()) {
@@ -243,7 +651,7 @@ namespace battlesnake {
                     shortest_dist = path.size();
                 }
             }
-        }
+        });
         if (shortest_dist == std::numeric_limits<size_t>::max()) {
             return std::numeric_limits<int>::max();
         } else {
@@ -253,28 +661,28 @@ namespace battlesnake {
 
     //Returns a 2d vector of the board positions with each value representing how many turns until
     // a snake larger than the subject snake could occupy it
-    std::vector<std::vector<int>> Board::getHeadThreat(const Snake& subject) const {
-        std::vector<std::vector<int>> head_threat = std::vector<std::vector<int>>(
-            m_height, std::vector<int>(m_width, 9999)
-        );
+    Grid<int> Board::getHeadThreat(int subject) const {
+        Grid<int> head_threat(m_width, m_height, 9999);
         std::vector<std::queue<HeadThreatFNode>> frontiers;
         std::vector<bool> is_threat;    //True if other snake is larger
         std::vector<int> rel_size;  //other snake length - subject_snake length
-        for (const Snake& s : m_snakes) {
+        const int subject_length = m_snakes.lengths[subject];
+        for (int s=0; s<m_snakes.count; s++) {
             std::queue<HeadThreatFNode> snake_frontier;
-            if (s.m_id == subject.m_id) {continue;}
-            is_threat.push_back(s.m_length >= subject.m_length);
-            rel_size.push_back(s.m_length - subject.m_length);
-            std::vector<Coord> start_positions = simulateOptions(s.m_head, 1);
-            for (const Coord& pos : start_positions) {
+            if (s == subject || !m_snakes.alive[s]) {continue;}
+            const int length = m_snakes.lengths[s];
+            is_threat.push_back(length >= subject_length);
+            rel_size.push_back(length - subject_length);
+            const NeighborList start_positions = simulateOptions(m_snakes.heads[s], 1);
+            for (Cell pos_index : start_positions) {
                 snake_frontier.push({
-                    {pos},
-                    m_food_array[pos.y][pos.x] ? 1 : 0
+                    {toCoord(pos_index)},
+                    m_food_bits.test(pos_index) ? 1 : 0
                 });
-                if (s.m_length >= subject.m_length){
-                    head_threat[pos.y][pos.x] = 1;
-                } else if (head_threat[pos.y][pos.x] > 1){
-                    head_threat[pos.y][pos.x] = 2;
+                if (length >= subject_length){
+                    head_threat[pos_index] = 1;
+                } else if (head_threat[pos_index] > 1){
+                    head_threat[pos_index] = 2;
                 }
             }
             frontiers.push_back(snake_frontier);
@@ -293,8 +701,11 @@ namespace battlesnake {
                 //Loop until all paths of length cur_dist explored
                 while (true) {
                     //Explore path head
-                    std::vector<Coord> to_explore = simulateOptions(cur_node.path.back(), cur_dist+1);
-                    for (const Coord& pos : to_explore) {
+                    const Coord& path_head = cur_node.path.back();
+                    const NeighborList to_explore = simulateOptions(
+                        toCell(path_head), cur_dist+1
+                    );
+                    for (Cell pos_index : to_explore) {
                         //Smaller snakes still have dangerous bodies, so threat is delayed by 1
                         int threat_delay;
                         //Account for food eaten along this path
@@ -304,13 +715,13 @@ namespace battlesnake {
                             threat_delay = 1;
                         }
                         //Explore if this is the shortest path to this position
-                        if (cur_dist + threat_delay + 1 < head_threat[pos.y][pos.x]){
-                            head_threat[pos.y][pos.x] = cur_dist + threat_delay + 1;
+                        if (cur_dist + threat_delay + 1 < head_threat[pos_index]){
+                            head_threat[pos_index] = cur_dist + threat_delay + 1;
                             std::vector<Coord> new_path = cur_node.path;
-                            new_path.push_back(pos);
+                            new_path.push_back(toCoord(pos_index));
                             f.push({
                                 new_path,
-                                m_food_array[pos.y][pos.x] ? cur_node.food_count+1 : cur_node.food_count
+                                m_food_bits.test(pos_index) ? cur_node.food_count+1 : cur_node.food_count
                             });
                         }
                     }
@@ -329,19 +740,13 @@ namespace battlesnake {
         return head_threat;
     }
 
-    Board::Snake::Snake(const json& snake): 
+    SnakeInfo::SnakeInfo(const json& snake): 
         m_id(snake["id"]), 
-        m_head(snake["head"]), 
         m_customizations(snake["customizations"]),
         m_name(snake["name"]), 
-        m_health(snake["health"]),
-        m_length(snake["length"]), 
-        m_shout(snake["shout"])
+        m_shout(snake["shout"]),
+        m_latency(0)
     {
-        for (const auto &snake_body: snake["body"]) {
-            m_body.emplace_back(snake_body);
-        }
-
         // The implementation varies, sometime it is an int sometimes a string
         if(snake["latency"].is_string()) {
             try {
@@ -355,37 +760,33 @@ namespace battlesnake {
         }
     }
 
-    //Returns strings up, down, left, or right based on relative direction from snake's head
-    // destination must be exactly one space away from snake's head
-    std::string Board::Snake::getDirectionStr(const Coord& destination) const {
-        assert((abs(m_head.x - destination.x) + abs(m_head.y - destination.y)) == 1);
-
-        if (m_head.x == destination.x) {
-            if (m_head.y < destination.y) {
-                return "up";
-            } else {
-                return "down";
-            }
-        } else {
-            if (m_head.x < destination.x) {
-                return "right";
-            } else {
-                return "left";
+    //Returns the slot of the snake with this ID, or -1 if it is not on the board
+    int Board::snakeIndex(const std::string& snake_id) const {
+        for (int s=0; s<m_snakes.count; s++) {
+            if (snakeInfo(s).m_id == snake_id) {
+                return s;
             }
         }
+        return -1;
+    }
+
+    //Returns strings up, down, left, or right based on relative direction from snake's head
+    // destination must be exactly one space away from snake's head
+    std::string Board::getDirectionStr(int snake, const Coord& destination) const {
+        return directionName(m_neighbor_table->directionTo(m_snakes.heads[snake], toCell(destination)));
     }
 
     //Retuns a bool that is true if this snake needs to eat soon
-    bool Board::getHunger(const Snake& subject) const {
-        int dist_to_food = getFoodDist(subject.m_head);
+    bool Board::getHunger(int subject) const {
+        int dist_to_food = getFoodDist(toCoord(m_snakes.heads[subject]));
         if (dist_to_food == std::numeric_limits<int>::max()) {return false;}   //Ignore hunger if no path found to food
         //Hungry if we are running out of time to reach food
-        if (subject.m_health < dist_to_food + 10) {
+        if (m_snakes.health[subject] < dist_to_food + 10) {
             return true;
         }
         //Hungry anytime we aren't the biggest snake by 4
-        for (const Snake& s : m_snakes) {
-            if (s.m_id != subject.m_id && s.m_length + 4 > subject.m_length) {
+        for (int s=0; s<m_snakes.count; s++) {
+            if (s != subject && m_snakes.alive[s] && m_snakes.lengths[s] + 4 > m_snakes.lengths[subject]) {
                 return true;
             }
         }
@@ -395,61 +796,36 @@ namespace battlesnake {
     //Filters out certain death moves and then compares different risk categories
     std::string Board::getMove(const std::string& snake_id) const {
         //Get subject snake
-        const auto it = std::find_if(m_snakes.begin(), m_snakes.end(), 
-            [&snake_id](const Snake& s) {return s.m_id == snake_id;}
-        );
-        if (it == m_snakes.end()) {
+        const int mover = snakeIndex(snake_id);
+        if (mover == -1) {
             std::cout << "Warning: Snake not found!" << std::endl;
             return "up";
         }
-        Snake mover = *it;
+        const Cell mover_head = m_snakes.heads[mover];
+        const int mover_length = m_snakes.lengths[mover];
         /*
-        std::vector<std::vector<int>> head_risk = getHeadThreat(mover);
+        Grid<int> head_risk = getHeadThreat(mover);
         for (int i=m_height-1; i>= 0; i--){
-            for (int cell : head_risk[i]){
+            for (int j=0; j<m_width; j++){
                 std::cout.fill(' ');
                 std::cout.width(5);
-                std::cout << cell;
+                std::cout << head_risk(j, i);
             }
             std::cout << std::endl;
         }
         */
-        //Get in-bounds adjacent coords
-        std::vector<Coord> candidate_moves = getNeighbors(mover.m_head);
-        //Filter out any self body parts
-        candidate_moves.erase(
-            std::remove_if(
-                candidate_moves.begin(), candidate_moves.end(),
-                [mover](const Coord& c) {
-                    //Ignore last body part as it will move forwards
-                    return std::find(
-                        mover.m_body.begin(), mover.m_body.end() - 1, c
-                    ) != mover.m_body.end() - 1;
-                }
-            ),
-            candidate_moves.end()
-        );
-        //Filter out body parts of other snakes above 1 health
-        candidate_moves.erase(
-            std::remove_if(
-                candidate_moves.begin(), candidate_moves.end(),
-                [this](const Coord& c) {
-                    for (const Snake& s : m_snakes) {
-                        if (std::find(s.m_body.begin(), s.m_body.end() - 1, c) != s.m_body.end()-1) {
-                            if (s.m_health > 1) {
-                                return true;
-                            } else {
-                                return false;
-                            }
-                        }
-                    }
-                    return false;
-                }
-            ),
-            candidate_moves.end()
-        );
+        //Keep in-bounds adjacent coords that no body will still occupy next turn
+        const MoveMask legal = legalMoves(*this, mover);
+        std::vector<Coord> candidate_moves;
+        for (Cell c : getNeighbors(mover_head)) {
+            if (legal & directionBit(m_neighbor_table->directionTo(mover_head, c))) {
+                candidate_moves.push_back(toCoord(c));
+            }
+        }
         if (!candidate_moves.empty()) {
             bool is_hungry = getHunger(mover);
+            //Threat map is the same for every candidate, so build it at most once
+            std::optional<Grid<int>> head_threats;
             //Now do risk analysis
             std::vector<int> final_risks;
             std::vector<int> food_distances;
@@ -460,47 +836,43 @@ namespace battlesnake {
                 int volume_worst_case_risk = 0; //Accounts for where heads will go
                 int head_on_risk = 0;
                 int eating_risk = 0;
-                int volume = measureVolume(c, mover.m_length, false);
-                if (volume < mover.m_length) {
-                    volume_risk = -100 - (mover.m_length - volume);
+                int volume = measureVolume(c, mover_length, false);
+                if (volume < mover_length) {
+                    volume_risk = -100 - (mover_length - volume);
                 } else {
                     volume_risk = 0;
-                    std::vector<std::vector<int>> head_threats = getHeadThreat(mover);
-                    int volume_worst_case = measureVolume(c, mover.m_length, true, &head_threats);
-                    if (volume_worst_case < mover.m_length){
-                        volume_worst_case_risk = -50 - (mover.m_length - volume_worst_case);
+                    if (!head_threats) {
+                        head_threats = getHeadThreat(mover);
+                    }
+                    int volume_worst_case = measureVolume(c, mover_length, true, &*head_threats);
+                    if (volume_worst_case < mover_length){
+                        volume_worst_case_risk = -50 - (mover_length - volume_worst_case);
                     }
                 }
                 
-                for (const Coord& adj_c : getNeighbors(c)) {
-                    if (!(adj_c == mover.m_head) && m_heads_array[adj_c.y][adj_c.x] != 0) {
-                        if (m_heads_array[adj_c.y][adj_c.x] >= mover.m_length) {
+                for (Cell adj_cell : getNeighbors(toCell(c))) {
+                    if (adj_cell != mover_head && m_head_bits.test(adj_cell)) {
+                        if (m_heads_array[adj_cell] >= mover_length) {
                             head_on_risk = -10;
-                        } else if (m_heads_array[adj_c.y][adj_c.x] < mover.m_length) {
+                        } else if (m_heads_array[adj_cell] < mover_length) {
                             head_on_risk = 10;
                         }
                     }
                 }
                 //If a snakes body is still a candidate then it MUST be at 1 health
                 //So check if there is risk of this snake surviving the turn by eating
-                if (!m_obstacles_array[c.y][c.x] == 0) {
+                if (obstacleTimer(toCell(c)) != 0) {
                     //TODO: better way to look this up
                     int could_eat = 0;
-                    for (const Snake& s : m_snakes) {
-                        for (const Coord& body_part : s.m_body) {
-                            if (c == body_part) {
-                                //Found the snake in question, check if it can eat
-                                std::vector<Coord> possible_moves = getNeighbors(s.m_head);
-                                for (const Coord& one_move : possible_moves) {
-                                    if (m_food_array[one_move.y][one_move.x]) {
-                                        could_eat = -10;
-                                        break;
-                                    }
+                    for (int s=0; s<m_snakes.count; s++) {
+                        if (m_snakes.alive[s] && m_snakes.bodies[s].contains(toCell(c))) {
+                            //Found the snake in question, check if it can eat
+                            for (Cell one_move : getNeighbors(m_snakes.heads[s])) {
+                                if (m_food_bits.test(one_move)) {
+                                    could_eat = -10;
+                                    break;
                                 }
                             }
-                            if (could_eat == -10) {
-                                break;
-                            }
                         }
                         if (could_eat == -10) {
                             break;
@@ -518,7 +890,7 @@ namespace battlesnake {
                 final_risk += volume_worst_case_risk;
                 final_risk += head_on_risk;
                 final_risk += eating_risk;
-                std::cout << mover.getDirectionStr(c) << ": ";
+                std::cout << getDirectionStr(mover, c) << ": ";
                 std::cout << final_risk << ", ";
                 std::cout << volume_risk << ", ";
                 std::cout << volume_worst_case_risk << ", ";
@@ -546,7 +918,7 @@ namespace battlesnake {
                 }
                 i_candidate++;
             }
-            return mover.getDirectionStr(final_candidates[rand() % final_candidates.size()]);
+            return getDirectionStr(mover, final_candidates[threadRng().below(static_cast<int>(final_candidates.size()))]);
         } else {
             std::cout << "Crap I'm surrounded!" << std::endl;
             return "up";
@@ -576,17 +948,42 @@ namespace battlesnake {
         timeout = game["timeout"];
     }
 
+    bool Game::isWrapped() const {
+        return ruleset.name() == "wrapped";
+    }
+
     GameState::GameState(const json& state): 
         game(state["game"]), 
         turn(state["turn"]),
-        board(state["board"]), 
+        board(state["board"], game.isWrapped()), 
         you_id(state["you"]["id"])
     {
         std::cout << "Turn " << turn << ":\n"; 
     }
 
-    std::string GameState::getMyMove() const {
-        return board.getMove(you_id);
+    /*
+    Picks our move with the engine chosen at startup, searching until the deadline. If the search
+    could not finish a single iteration the deadline has already passed, so we fall back to the
+    cheap movegen choice rather than the heuristic's path finding and flood fills.
+    */
+    std::string GameState::getMyMove(SearchClock::time_point deadline, GameEngine* engine) const {
+        const int me = board.snakeIndex(you_id);
+        if (engine == nullptr || me == -1) {
+            return board.getMove(you_id);
+        }
+        const SearchResult result = engine->chooseMove(board, you_id, deadline);
+        if (result.depth == 0) {
+            std::cout << "Search ran out of time, playing the default move" << std::endl;
+            return directionName(defaultMove(board, me));
+        }
+        std::cout << "Search depth " << result.depth << ", score " << result.score
+                  << ", nodes " << result.nodes << std::endl;
+        return directionName(result.move);
+    }
+
+    int GameState::getMyLatency() const {
+        const int me = board.snakeIndex(you_id);
+        return me == -1 ? 0 : board.snakeInfo(me).m_latency;
     }
 
     Customizations::Customizations(json customizations) {
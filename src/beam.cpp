@@ -0,0 +1,137 @@
+#include "beam.h"
+#include "evaluation.h"
+#include "movegen.h"
+#include <algorithm>
+
+namespace battlesnake {
+    BeamSearch::BeamSearch(const Rules& rules): m_rules(rules) {}
+
+    bool BeamSearch::timeUp() const {
+        return SearchClock::now() >= m_limits.deadline || m_limits.stopSignalled();
+    }
+
+    //The opponents' answer to our move: a head that wins or ties the collision meets ours, the rest play on
+    JointMove BeamSearch::reply(const Board& board, Direction our_move) const {
+        const SnakeStore& snakes = board.m_snakes;
+        const NeighborTable& table = *board.m_neighbor_table;
+        const Cell target = table.step(snakes.heads[m_subject], our_move);
+        JointMove moves{};
+        moves[m_subject] = our_move;
+        bool met = false;
+        for (int s=0; s<snakes.count; s++) {
+            if (s == m_subject || !snakes.alive[s]) {continue;}
+            moves[s] = defaultMove(board, s);
+            if (met || target == NO_CELL || snakes.lengths[s] < snakes.lengths[m_subject]) {continue;}
+            const MoveMask legal = legalMoves(board, s);
+            for (int d=0; d<NUM_DIRECTIONS; d++) {
+                const Direction direction = static_cast<Direction>(d);
+                if ((legal & directionBit(direction)) && table.step(snakes.heads[s], direction) == target) {
+                    moves[s] = direction;
+                    met = true;
+                }
+            }
+        }
+        return moves;
+    }
+
+    //Scores a position ply turns in, returning true when the game is decided there
+    bool BeamSearch::scoreState(const Board& board, int ply, int& score) const {
+        if (!board.m_snakes.alive[m_subject]) {
+            score = -WIN_SCORE + ply;
+            return true;
+        }
+        if (!m_solo && board.aliveCount() == 1) {
+            score = WIN_SCORE - ply;
+            return true;
+        }
+        score = quickEvaluate(board, m_subject);
+        return false;
+    }
+
+    /*
+    Width for the next turn: what is left of the time shared out over the turns still wanted,
+    at least a few, at the cost per child measured this turn and about three moves per state.
+    */
+    int BeamSearch::nextWidth(SearchClock::time_point turn_start, int children, int depth) const {
+        const SearchClock::time_point now = SearchClock::now();
+        const double per_child = std::chrono::duration<double>(now - turn_start).count() / std::max(1, children);
+        const double remaining = std::chrono::duration<double>(m_limits.deadline - now).count();
+        const int turns_left = std::max(4, BEAM_TARGET_DEPTH - depth);
+        const double width = remaining / (turns_left * (NUM_DIRECTIONS - 1) * std::max(per_child, 1e-9));
+        return static_cast<int>(std::clamp(width, static_cast<double>(MIN_BEAM_WIDTH), static_cast<double>(MAX_BEAM_WIDTH)));
+    }
+
+    SearchResult BeamSearch::search(const Board& root, int subject, const SearchLimits& limits) {
+        m_subject = subject;
+        m_limits = limits;
+        m_solo = root.aliveCount() <= 1;
+
+        SearchResult result;
+        const MoveList root_moves = orderedMoves(root, subject, legalMoves(root, subject));
+        result.move = root_moves[0];
+        //Nothing to decide, answer straight away and leave the time to the caller
+        if (root_moves.size() == 1) {
+            result.depth = 1;
+            return result;
+        }
+        m_beam.clear();
+        m_beam.push_back({root, root_moves[0], 0, false});
+        int width = MAX_BEAM_WIDTH;
+        for (int depth=1; depth<=limits.max_depth; depth++) {
+            const SearchClock::time_point turn_start = SearchClock::now();
+            m_candidates.clear();
+            bool stopped = false;
+            for (int i=0; i<static_cast<int>(m_beam.size()); i++) {
+                State& state = m_beam[i];
+                if (state.decided) {
+                    m_candidates.push_back({i, JointMove{}, state.score, true});
+                    continue;
+                }
+                const MoveList moves = depth == 1 ? root_moves
+                    : orderedMoves(state.board, subject, legalMoves(state.board, subject));
+                for (Direction move : moves) {
+                    Candidate candidate{i, reply(state.board, move), 0, false};
+                    const UndoRecord record = m_rules.step(state.board, candidate.moves);
+                    candidate.decided = scoreState(state.board, depth, candidate.score);
+                    m_rules.undo(state.board, record);
+                    m_candidates.push_back(candidate);
+                    result.nodes++;
+                }
+                //The first turn is always finished so there is a move to play
+                if (depth > 1 && timeUp()) {
+                    stopped = true;
+                    break;
+                }
+            }
+            if (stopped) {break;}
+
+            const int children = static_cast<int>(m_candidates.size());
+            if (children > width) {
+                std::nth_element(m_candidates.begin(), m_candidates.begin() + width, m_candidates.end(),
+                    [](const Candidate& a, const Candidate& b) {return a.score > b.score;});
+                m_candidates.resize(width);
+            }
+            m_next.clear();
+            for (const Candidate& candidate : m_candidates) {
+                const State& parent = m_beam[candidate.parent];
+                const Direction first = depth == 1 ? candidate.moves[subject] : parent.first;
+                m_next.push_back({parent.board, first, candidate.score, candidate.decided});
+                if (!parent.decided) {
+                    m_rules.step(m_next.back().board, candidate.moves);
+                }
+            }
+            std::swap(m_beam, m_next);
+
+            const State& best = *std::max_element(m_beam.begin(), m_beam.end(),
+                [](const State& a, const State& b) {return a.score < b.score;});
+            result.move = best.first;
+            result.score = best.score;
+            result.depth = depth;
+            const bool all_decided = std::all_of(m_beam.begin(), m_beam.end(),
+                [](const State& state) {return state.decided;});
+            if (all_decided || timeUp()) {break;}
+            width = nextWidth(turn_start, children, depth);
+        }
+        return result;
+    }
+} // battlesnake
@@ -0,0 +1,243 @@
+#include "bench.h"
+#include "movegen.h"
+#include "rng.h"
+#include "search.h"
+#include <algorithm>
+#include <array>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace battlesnake {
+    /*
+    Positions as "width height | food x,y ... | hazards x,y ... | health: x,y ... | ...", one
+    snake per field from the head down, ours first. Duels, free-for-alls, a cramped board and
+    snakes close to starving.
+    */
+    constexpr std::array BENCH_POSITIONS = {
+        "11 11 | food 5,5 0,4 10,6 | hazards | 100: 1,5 1,5 1,5 | 100: 9,5 9,5 9,5",
+        "7 7 | food 3,3 0,2 6,4 | hazards | 100: 1,1 1,1 1,1 | 100: 5,5 5,5 5,5",
+        "11 11 | food 3,7 10,10 | hazards | 80: 4,5 4,4 4,3 5,3 6,3 6,4 6,5 | 60: 4,7 5,7 6,7 7,7 8,7 8,6 8,5 8,4 | 1: 2,5 2,4 2,3",
+        "11 11 | food | hazards 0,4 7,9 | 60: 9,7 10,7 10,8 10,9 10,10 9,10 8,10 8,9 | 60: 6,10 7,10 7,9 6,9 6,8 6,7 7,7 7,6 8,6 9,6",
+        "19 19 | food 12,8 | hazards 1,6 0,13 | 60: 5,0 4,0 4,1 4,2 5,2 | 100: 1,12 0,12 0,11 0,10 1,10 2,10 3,10 4,10 5,10 6,10 6,9 6,8 7,8 7,7 | 5: 9,6 8,6 8,5 7,5",
+        "9 9 | food | hazards 5,0 7,5 | 60: 4,2 4,3 5,3 6,3 7,3 7,4 7,5 6,5 | 60: 6,2 6,1 7,1 8,1 8,2 7,2 | 5: 3,5 4,5 4,4 5,4 5,5 5,6 6,6 6,7 6,8 7,8 7,7",
+        "9 9 | food 6,4 5,8 3,1 0,5 | hazards 3,1 5,1 | 100: 7,8 7,7 8,7 8,6 8,5 8,4 8,3 | 100: 4,6 4,7 4,8 3,8",
+        "11 13 | food 7,12 10,3 | hazards | 60: 3,8 3,9 2,9 2,8 2,7 2,6 | 5: 5,9 5,10 4,10 4,11 3,11 3,10 2,10 1,10 0,10 0,9 1,9 1,8 0,8",
+    };
+
+    //The first snake's head runs right into the second snake's tail end as it moves down
+    constexpr const char* COLLISION_POSITION = "11 11 | food | hazards | 100: 4,6 3,6 2,6 1,6 0,6 0,7 1,7 2,7 | 100: 5,5 5,6 5,7";
+    //Positions whose bodies differ only by a stacked tail, which must not hash the same
+    constexpr std::array STACKED_TAIL_POSITIONS = {
+        "11 11 | food | hazards | 100: 5,5 5,4 5,3 5,3",
+        "11 11 | food | hazards | 100: 5,5 5,4",
+    };
+
+    static json coordinate(const std::string& text) {
+        const size_t comma = text.find(',');
+        return {{"x", std::stoi(text.substr(0, comma))}, {"y", std::stoi(text.substr(comma + 1))}};
+    }
+
+    //Builds the board part of a /move request from a bench position
+    static json benchBoard(const std::string& position) {
+        std::vector<std::string> fields;
+        std::istringstream stream(position);
+        for (std::string field; std::getline(stream, field, '|');) {
+            fields.push_back(field);
+        }
+        json board;
+        std::istringstream size(fields[0]);
+        int width;
+        int height;
+        size >> width >> height;
+        board["width"] = width;
+        board["height"] = height;
+        const std::array<const char*, 2> item_keys = {"food", "hazards"};
+        for (size_t k=0; k<item_keys.size(); k++) {
+            const char* key = item_keys[k];
+            board[key] = json::array();
+            std::istringstream cells(fields[k + 1]);
+            std::string word;
+            cells >> word;
+            while (cells >> word) {
+                board[key].push_back(coordinate(word));
+            }
+        }
+        board["snakes"] = json::array();
+        for (size_t i=3; i<fields.size(); i++) {
+            std::istringstream cells(fields[i]);
+            std::string word;
+            cells >> word;
+            json snake;
+            snake["id"] = "s" + std::to_string(i - 3);
+            snake["name"] = snake["id"];
+            snake["health"] = std::stoi(word);
+            snake["latency"] = "0";
+            snake["shout"] = "";
+            snake["customizations"] = {{"color", "#000000"}, {"head", "default"}, {"tail", "default"}};
+            snake["body"] = json::array();
+            while (cells >> word) {
+                snake["body"].push_back(coordinate(word));
+            }
+            snake["head"] = snake["body"][0];
+            snake["length"] = snake["body"].size();
+            board["snakes"].push_back(snake);
+        }
+        return board;
+    }
+
+    void runBench(int depth, std::ostream& out) {
+        const Rules rules(15, 1, 14);
+        SearchLimits limits;
+        limits.deadline = SearchClock::time_point::max();
+        limits.max_depth = depth;
+        uint64_t total_nodes = 0;
+        const SearchClock::time_point start = SearchClock::now();
+        for (size_t i=0; i<BENCH_POSITIONS.size(); i++) {
+            const Board board(benchBoard(BENCH_POSITIONS[i]));
+            TranspositionTable table(4);
+            AlphaBetaSearch search(rules, &table);
+            const SearchResult result = search.search(board, 0, limits);
+            out << "Position " << i + 1 << ": " << directionName(result.move) << ", depth " << result.depth
+                << ", score " << result.score << ", nodes " << result.nodes << std::endl;
+            total_nodes += result.nodes;
+        }
+        const double seconds = std::chrono::duration<double>(SearchClock::now() - start).count();
+        out << "Total nodes " << total_nodes << ", " << static_cast<uint64_t>(total_nodes / std::max(seconds, 1e-9))
+            << " nodes/s" << std::endl;
+    }
+
+    //The board part of a /move request for the living snakes, for parsing the position again
+    static json boardJson(const Board& board) {
+        json out;
+        out["width"] = board.m_width;
+        out["height"] = board.m_height;
+        auto coordinates = [&](const Bitboard& cells) {
+            json list = json::array();
+            cells.forEach([&](int c) {
+                const Coord pos = board.toCoord(static_cast<Cell>(c));
+                list.push_back({{"x", pos.x}, {"y", pos.y}});
+            });
+            return list;
+        };
+        out["food"] = coordinates(board.m_food_bits);
+        out["hazards"] = coordinates(board.m_hazard_bits);
+        out["snakes"] = json::array();
+        const SnakeStore& snakes = board.m_snakes;
+        for (int s=0; s<snakes.count; s++) {
+            if (!snakes.alive[s]) {continue;}
+            json snake;
+            snake["id"] = board.snakeInfo(s).m_id;
+            snake["name"] = board.snakeInfo(s).m_name;
+            snake["health"] = snakes.health[s];
+            snake["latency"] = "0";
+            snake["shout"] = "";
+            snake["customizations"] = {{"color", "#000000"}, {"head", "default"}, {"tail", "default"}};
+            snake["body"] = json::array();
+            const BodyRing& body = snakes.bodies[s];
+            for (Cell c : body) {
+                const Coord pos = board.toCoord(c);
+                snake["body"].push_back({{"x", pos.x}, {"y", pos.y}});
+            }
+            snake["head"] = snake["body"][0];
+            snake["length"] = snakes.lengths[s];
+            out["snakes"].push_back(snake);
+        }
+        return out;
+    }
+
+    static bool sameSnakes(const SnakeStore& a, const SnakeStore& b) {
+        if (a.count != b.count) {return false;}
+        for (int s=0; s<a.count; s++) {
+            if (a.heads[s] != b.heads[s] || a.health[s] != b.health[s] || a.lengths[s] != b.lengths[s]
+                || a.alive[s] != b.alive[s] || a.bodies[s] != b.bodies[s]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //First cell whose timer or occupancy differs between the boards, -1 if none
+    static int timerMismatch(const Board& board, const Board& expected) {
+        for (int c=0; c<board.m_width * board.m_height; c++) {
+            const Cell cell = static_cast<Cell>(c);
+            if (board.isOccupied(cell) != expected.isOccupied(cell)
+                || board.obstacleTimer(cell) != expected.obstacleTimer(cell)) {
+                return c;
+            }
+        }
+        return -1;
+    }
+
+    //Checks one step and its undo, returning the number of failed checks
+    static int checkStep(const Rules& rules, Board& board, const JointMove& moves, Rng& rng, std::ostream& out) {
+        const Board before = board;
+        const UndoRecord record = rules.step(board, moves, &rng);
+        int failures = 0;
+        auto fail = [&](const std::string& what) {
+            failures++;
+            out << what << " at ply " << board.ply() << ": " << boardJson(board).dump() << std::endl;
+        };
+        if (board.hash() != board.computeHash()) {fail("Hash differs from computeHash after step");}
+        const Board rebuilt(boardJson(board));
+        const int cell = timerMismatch(board, rebuilt);
+        if (cell != -1) {
+            fail("Timer of cell " + std::to_string(cell) + " is " + std::to_string(board.obstacleTimer(cell))
+                + ", parsed position has " + std::to_string(rebuilt.obstacleTimer(cell)));
+        }
+        rules.undo(board, record);
+        if (board.hash() != before.hash() || board.ply() != before.ply() || timerMismatch(board, before) != -1
+            || !sameSnakes(board.m_snakes, before.m_snakes) || !(board.m_food_bits == before.m_food_bits)
+            || !(board.m_head_bits == before.m_head_bits)) {
+            fail("Undo does not restore the position");
+        }
+        rules.step(board, moves, &rng);
+        return failures;
+    }
+
+    //Mostly legal moves, sometimes any direction so bodies and walls get hit too
+    static JointMove randomMoves(const Board& board, Rng& rng) {
+        JointMove moves{};
+        for (int s=0; s<board.m_snakes.count; s++) {
+            if (!board.m_snakes.alive[s]) {continue;}
+            const MoveMask legal = legalMoves(board, s);
+            MoveList options;
+            for (int d=0; d<NUM_DIRECTIONS; d++) {
+                const Direction direction = static_cast<Direction>(d);
+                if (legal == 0 || rng.below(8) == 0 || (legal & directionBit(direction))) {
+                    options.push(direction);
+                }
+            }
+            moves[s] = options[rng.below(options.size())];
+        }
+        return moves;
+    }
+
+    int runSelfCheck(int games, std::ostream& out) {
+        const Rules rules(15, 1, 14);
+        Rng rng(1);
+        int failures = 0;
+        const Board stacked(benchBoard(STACKED_TAIL_POSITIONS[0]));
+        const Board unstacked(benchBoard(STACKED_TAIL_POSITIONS[1]));
+        if (stacked.hash() == unstacked.hash()) {
+            failures++;
+            out << "A stacked tail does not change the hash" << std::endl;
+        }
+        Board collision(benchBoard(COLLISION_POSITION));
+        JointMove moves{};
+        moves[0] = Direction::Right;
+        moves[1] = Direction::Down;
+        failures += checkStep(rules, collision, moves, rng, out);
+
+        uint64_t steps = 1;
+        for (int game=0; game<games; game++) {
+            Board board(benchBoard(BENCH_POSITIONS[game % BENCH_POSITIONS.size()]));
+            while (board.aliveCount() > 1) {
+                failures += checkStep(rules, board, randomMoves(board, rng), rng, out);
+                steps++;
+            }
+        }
+        out << "Games " << games << ", steps " << steps << ", failures " << failures << std::endl;
+        return failures;
+    }
+} // battlesnake
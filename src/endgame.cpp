@@ -0,0 +1,314 @@
+#include "endgame.h"
+#include "evaluation.h"
+#include <algorithm>
+#include <bit>
+
+namespace battlesnake {
+    EndgameSolver::EndgameSolver(const Rules& rules): m_rules(rules) {}
+
+    //Cells the snake could reach through cells that free up within horizon turns; false if too many
+    bool EndgameSolver::growRegion(int snake, int horizon, Bitboard& region) const {
+        const Board& board = *m_board;
+        region.clear();
+        Cell stack[MAX_SEALED_CELLS];
+        int size = 0;
+        int count = 1;
+        region.set(board.m_snakes.heads[snake]);
+        stack[size++] = board.m_snakes.heads[snake];
+        while (size > 0) {
+            const Cell c = stack[--size];
+            for (Cell n : board.getNeighbors(c)) {
+                if (region.test(n) || board.obstacleTimer(n) > horizon) {continue;}
+                if (++count > MAX_SEALED_CELLS) {return false;}
+                region.set(n);
+                stack[size++] = n;
+            }
+        }
+        return true;
+    }
+
+    //Extra moves the snake can make from local cell with the visited cells behind it
+    int EndgameSolver::longestPath(int local, uint32_t visited) {
+        const uint64_t key = (uint64_t{static_cast<uint32_t>(local)} << 32) | visited;
+        const auto found = m_memo.find(key);
+        if (found != m_memo.end()) {return found->second;}
+        if (++m_nodes > m_node_limit) {
+            m_aborted = true;
+            return 0;
+        }
+        //Every food eaten holds the tail back a turn
+        const int moves = std::popcount(visited) - 1;
+        const int eaten = std::popcount(visited & m_food);
+        int best = 0;
+        uint32_t open = m_adjacent[local] & ~visited;
+        while (open != 0 && !m_aborted) {
+            const int next = std::countr_zero(open);
+            open &= open - 1;
+            if (m_timers[next] > 0 && m_timers[next] + eaten > moves) {continue;}
+            best = std::max(best, 1 + longestPath(next, visited | (uint32_t{1} << next)));
+        }
+        m_memo.emplace(key, best);
+        return best;
+    }
+
+    /*
+    Longest path inside the region, with the first move of one in move; -1 when the region holds
+    another snake's body, which frees up on a schedule of its own, or the search gave up.
+    */
+    int EndgameSolver::regionPath(int snake, const Bitboard& region, Direction& move) {
+        const Board& board = *m_board;
+        m_cells.clear();
+        std::array<int8_t, MAX_CELLS> local;
+        bool foreign = false;
+        region.forEach([&](int c) {
+            local[c] = static_cast<int8_t>(m_cells.size());
+            m_cells.push_back(static_cast<Cell>(c));
+            foreign = foreign || (m_owner[c] != -1 && m_owner[c] != snake);
+        });
+        if (foreign) {return -1;}
+        m_food = 0;
+        for (int i=0; i<static_cast<int>(m_cells.size()); i++) {
+            const Cell c = m_cells[i];
+            m_timers[i] = board.obstacleTimer(c);
+            m_adjacent[i] = 0;
+            for (Cell n : board.getNeighbors(c)) {
+                if (region.test(n)) {
+                    m_adjacent[i] |= uint32_t{1} << local[n];
+                }
+            }
+            if (board.m_food_bits.test(c)) {
+                m_food |= uint32_t{1} << i;
+            }
+        }
+        m_memo.clear();
+        m_aborted = false;
+        m_node_limit = m_nodes + MAX_ENDGAME_NODES;
+        const Cell head = board.m_snakes.heads[snake];
+        const int start = local[head];
+        const uint32_t visited = uint32_t{1} << start;
+        int best = 0;
+        uint32_t open = m_adjacent[start];
+        while (open != 0) {
+            const int next = std::countr_zero(open);
+            open &= open - 1;
+            if (m_timers[next] > 0) {continue;}
+            const int length = 1 + longestPath(next, visited | (uint32_t{1} << next));
+            if (length > best) {
+                best = length;
+                move = board.m_neighbor_table->directionTo(head, m_cells[next]);
+            }
+        }
+        return m_aborted ? -1 : best;
+    }
+
+    /*
+    Seals the snake off when nothing else can reach it while it lives and its survival is exact.
+    Starting from no turns, the region grows to the cells that free up within the snake's
+    longest path in it, until that path no longer gets longer: a path leaving the region would
+    first have to outlast it. The path must also end before starvation, stay out of damaging
+    hazards and be shorter than the snake, so no cell it left frees up behind it.
+    */
+    void EndgameSolver::sealSnake(int snake, Survival& survival) {
+        const Board& board = *m_board;
+        const SnakeStore& snakes = board.m_snakes;
+        Bitboard& region = survival.region;
+        int horizon = 0;
+        while (true) {
+            if (!growRegion(snake, horizon, region)) {return;}
+            if (m_rules.hazardDamage() > 0 && (region & board.m_hazard_bits).any()) {return;}
+            for (int s=0; s<snakes.count; s++) {
+                if (s == snake || !snakes.alive[s]) {continue;}
+                const Cell head = snakes.heads[s];
+                if (region.test(head)) {return;}
+                for (Cell n : board.getNeighbors(head)) {
+                    if (region.test(n)) {return;}
+                }
+            }
+            Direction move = Direction::Up;
+            const int turns = regionPath(snake, region, move);
+            if (turns < 0 || turns >= snakes.lengths[snake] || turns >= snakes.health[snake]) {return;}
+            if (turns <= horizon) {
+                survival.sealed = true;
+                survival.turns = turns;
+                survival.move = move;
+                region.forEach([&](int c) {
+                    for (Cell n : board.getNeighbors(static_cast<Cell>(c))) {
+                        if (!region.test(n) && m_owner[n] != -1 && m_owner[n] != snake) {
+                            survival.walls |= uint32_t{1} << m_owner[n];
+                        }
+                    }
+                });
+                return;
+            }
+            horizon = turns;
+        }
+    }
+
+    //Depth-first search for a path of target moves that keeps clear of other snakes' bodies
+    bool EndgameSolver::extendPath(Cell cell, int moves, int eaten, int target) {
+        if (moves >= target) {return true;}
+        if (++m_nodes > m_node_limit) {
+            m_aborted = true;
+            return false;
+        }
+        const Board& board = *m_board;
+        //Cells with the fewest ways on are tried first, which keeps the path from cutting itself off
+        std::array<std::pair<int, Cell>, NUM_DIRECTIONS> options;
+        int count = 0;
+        for (Cell n : board.getNeighbors(cell)) {
+            if (m_visited.test(n) || m_blocked.test(n)) {continue;}
+            const int timer = board.obstacleTimer(n);
+            if (timer > 0 && timer + eaten > moves) {continue;}
+            int exits = 0;
+            for (Cell e : board.getNeighbors(n)) {
+                exits += !m_visited.test(e) && !m_blocked.test(e);
+            }
+            options[count++] = {exits, n};
+        }
+        std::sort(options.begin(), options.begin() + count);
+        for (int i=0; i<count && !m_aborted; i++) {
+            const Cell n = options[i].second;
+            m_visited.set(n);
+            if (extendPath(n, moves + 1, eaten + board.m_food_bits.test(n), target)) {return true;}
+            m_visited.reset(n);
+        }
+        return false;
+    }
+
+    /*
+    Looks for a path on which the snake surely makes target moves while every other snake is
+    sealed off, keeping out of their regions and bodies. Food is not counted on for health.
+    */
+    bool EndgameSolver::findPath(int snake, int target, const Bitboard& avoid, Direction& move) {
+        const Board& board = *m_board;
+        if (board.m_snakes.health[snake] <= target) {return false;}
+        m_blocked = avoid;
+        for (int c=0; c<board.m_width * board.m_height; c++) {
+            if (m_owner[c] != -1 && m_owner[c] != snake) {
+                m_blocked.set(c);
+            }
+        }
+        if (m_rules.hazardDamage() > 0) {
+            m_blocked |= board.m_hazard_bits;
+        }
+        m_visited.clear();
+        const Cell head = board.m_snakes.heads[snake];
+        m_visited.set(head);
+        m_aborted = false;
+        m_node_limit = m_nodes + MAX_ENDGAME_NODES;
+        for (Cell n : board.getNeighbors(head)) {
+            if (m_blocked.test(n) || board.obstacleTimer(n) > 0) {continue;}
+            m_visited.set(n);
+            if (extendPath(n, 1, board.m_food_bits.test(n), target)) {
+                move = board.m_neighbor_table->directionTo(head, n);
+                return true;
+            }
+            m_visited.reset(n);
+            if (m_aborted) {break;}
+        }
+        return false;
+    }
+
+    /*
+    We lose when we are sealed off and some snake outlives us, and win when every opponent is
+    sealed off and we outlive them all. Sealed off alone, our longest path is our best move even
+    when the outcome is open.
+    */
+    EndgameResult EndgameSolver::solve(const Board& board, int subject) {
+        EndgameResult result;
+        const SnakeStore& snakes = board.m_snakes;
+        if (!snakes.alive[subject] || board.aliveCount() < 2) {return result;}
+        m_board = &board;
+        m_nodes = 0;
+        m_owner.fill(-1);
+        for (int s=0; s<snakes.count; s++) {
+            if (!snakes.alive[s]) {continue;}
+            const BodyRing& body = snakes.bodies[s];
+            for (Cell c : body) {
+                m_owner[c] = static_cast<int8_t>(s);
+            }
+        }
+        std::array<Survival, MAX_SNAKES> survival;
+        for (int s=0; s<snakes.count; s++) {
+            if (snakes.alive[s]) {
+                sealSnake(s, survival[s]);
+            }
+        }
+        //A wall of another snake's body holds only while that snake is sealed and outlasts the one inside
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (int s=0; s<snakes.count; s++) {
+                if (!snakes.alive[s] || !survival[s].sealed) {continue;}
+                for (uint32_t walls = survival[s].walls; walls != 0; walls &= walls - 1) {
+                    const Survival& wall = survival[std::countr_zero(walls)];
+                    if (!wall.sealed || wall.turns < survival[s].turns) {
+                        survival[s].sealed = false;
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+        int unsealed = 0;
+        for (int s=0; s<snakes.count; s++) {
+            unsealed += snakes.alive[s] && !survival[s].sealed;
+        }
+        //Cells a snake in open space must keep out of so the sealed snakes stay out of its way
+        auto sealed_regions = [&](int except) {
+            Bitboard regions;
+            for (int s=0; s<snakes.count; s++) {
+                if (s != except && snakes.alive[s] && survival[s].sealed) {
+                    regions |= survival[s].region;
+                }
+            }
+            return regions;
+        };
+
+        const Survival& ours = survival[subject];
+        if (ours.sealed) {
+            result.solved = true;
+            result.move = ours.move;
+            result.turns = ours.turns + 1;
+            for (int s=0; s<snakes.count; s++) {
+                if (s == subject || !snakes.alive[s]) {continue;}
+                Direction move;
+                const bool outlives = survival[s].sealed
+                    ? survival[s].turns > ours.turns
+                    : unsealed == 1 && findPath(s, ours.turns + 1, sealed_regions(s), move);
+                if (outlives) {
+                    result.proven = true;
+                    result.score = -WIN_SCORE + result.turns;
+                    break;
+                }
+            }
+            if (!result.proven && unsealed == 0) {
+                int longest = 0;
+                for (int s=0; s<snakes.count; s++) {
+                    if (s != subject && snakes.alive[s]) {
+                        longest = std::max(longest, survival[s].turns);
+                    }
+                }
+                if (longest < ours.turns) {
+                    result.proven = true;
+                    result.turns = longest + 1;
+                    result.score = WIN_SCORE - result.turns;
+                }
+            }
+        } else if (unsealed == 1) {
+            int longest = 0;
+            for (int s=0; s<snakes.count; s++) {
+                if (s != subject && snakes.alive[s]) {
+                    longest = std::max(longest, survival[s].turns);
+                }
+            }
+            if (findPath(subject, longest + 1, sealed_regions(subject), result.move)) {
+                result.proven = true;
+                result.solved = true;
+                result.turns = longest + 1;
+                result.score = WIN_SCORE - result.turns;
+            }
+        }
+        result.nodes = m_nodes;
+        return result;
+    }
+} // battlesnake
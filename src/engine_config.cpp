@@ -0,0 +1,99 @@
+#include "engine_config.h"
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace battlesnake {
+    void EngineConfig::parseOption(const std::string& option) {
+        const size_t equals = option.find('=');
+        if (option.rfind("--", 0) != 0 || equals == std::string::npos) {
+            throw std::invalid_argument("Expected --key=value, got " + option);
+        }
+        const std::string key = option.substr(2, equals - 2);
+        const std::string value = option.substr(equals + 1);
+        if (key == "engine") {
+            if (value == "heuristic") {
+                mode = EngineMode::Heuristic;
+            } else if (value == "alphabeta") {
+                mode = EngineMode::AlphaBeta;
+            } else if (value == "mcts") {
+                mode = EngineMode::Mcts;
+            } else {
+                throw std::invalid_argument("Unknown engine " + value);
+            }
+        } else if (key == "rollout") {
+            if (value == "random") {
+                rollout = RolloutMode::Random;
+            } else if (value == "eval") {
+                rollout = RolloutMode::Evaluation;
+            } else {
+                throw std::invalid_argument("Unknown rollout " + value);
+            }
+        } else if (key == "mcts-parallel") {
+            if (value == "root") {
+                mcts_parallelism = MctsParallelism::Root;
+            } else if (value == "tree") {
+                mcts_parallelism = MctsParallelism::Tree;
+            } else {
+                throw std::invalid_argument("Unknown MCTS parallelism " + value);
+            }
+        } else if (key == "hash") {
+            const int size = std::stoi(value);
+            if (size <= 0) {
+                throw std::invalid_argument("Hash size must be positive");
+            }
+            hash_mb = static_cast<size_t>(size);
+        } else if (key == "threads") {
+            threads = std::stoi(value);
+            if (threads < 0) {
+                throw std::invalid_argument("Thread count cannot be negative");
+            }
+        } else if (key == "maxn-snakes") {
+            maxn_snakes = std::stoi(value);
+            if (maxn_snakes < 0) {
+                throw std::invalid_argument("Max^n snake count cannot be negative");
+            }
+        } else if (key == "opponent-radius") {
+            opponent_radius = std::stoi(value);
+            if (opponent_radius < 0) {
+                throw std::invalid_argument("Opponent radius cannot be negative");
+            }
+        } else if (key == "max-opponents") {
+            max_opponents = std::stoi(value);
+            if (max_opponents < 1) {
+                throw std::invalid_argument("At least one opponent must be searched");
+            }
+        } else if (key == "beam-below") {
+            beam_below_ms = std::stoi(value);
+            if (beam_below_ms < 0) {
+                throw std::invalid_argument("Beam search threshold cannot be negative");
+            }
+        } else if (key == "ponder-threads") {
+            ponder_threads = std::stoi(value);
+            if (ponder_threads < 1) {
+                throw std::invalid_argument("Pondering needs at least one thread");
+            }
+        } else if (key == "ponder") {
+            if (value == "on") {
+                ponder = true;
+            } else if (value == "off") {
+                ponder = false;
+            } else {
+                throw std::invalid_argument("Ponder must be on or off");
+            }
+        } else {
+            throw std::invalid_argument("Unknown option " + key);
+        }
+    }
+
+    int EngineConfig::searchThreads() const {
+        if (threads > 0) {
+            return threads;
+        }
+        return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+
+    int EngineConfig::ponderThreads() const {
+        return std::min(ponder_threads, searchThreads());
+    }
+} // battlesnake
@@ -0,0 +1,121 @@
+#include "evaluation.h"
+
+namespace battlesnake {
+    constexpr int TERRITORY_WEIGHT = 10;
+    constexpr int LENGTH_WEIGHT = 30;
+    constexpr int OPPONENT_PENALTY = 300;
+    constexpr int TRAPPED_PENALTY = 2000;
+    constexpr int LOW_HEALTH = 25;
+    constexpr int LOW_HEALTH_WEIGHT = 8;
+    //Turns of flood fill behind quickEvaluate
+    constexpr int QUICK_REACH_TURNS = 6;
+
+    std::array<int, MAX_SNAKES> voronoiTerritory(const Board& board) {
+        const SnakeStore& snakes = board.m_snakes;
+        std::array<int, MAX_SNAKES> territory{};
+        std::array<Bitboard, MAX_SNAKES> frontiers;
+        Bitboard claimed;
+        for (int s=0; s<snakes.count; s++) {
+            if (snakes.alive[s]) {
+                frontiers[s].set(snakes.heads[s]);
+                claimed.set(snakes.heads[s]);
+            }
+        }
+        for (int t=1; t<=board.m_width * board.m_height; t++) {
+            const Bitboard free_cells = board.freeAfter(t);
+            Bitboard seen_once;
+            Bitboard seen_twice;
+            bool expanded = false;
+            for (int s=0; s<snakes.count; s++) {
+                if (!frontiers[s].any()) {continue;}
+                frontiers[s] = board.m_geometry.neighbors(frontiers[s]).andNot(claimed) & free_cells;
+                seen_twice |= seen_once & frontiers[s];
+                seen_once |= frontiers[s];
+                expanded = true;
+            }
+            if (!expanded) {break;}
+            for (int s=0; s<snakes.count; s++) {
+                if (!frontiers[s].any()) {continue;}
+                frontiers[s] = frontiers[s].andNot(seen_twice);
+                territory[s] += frontiers[s].count();
+            }
+            claimed |= seen_once;
+        }
+        return territory;
+    }
+
+    /*
+    Decided games score +-WIN_SCORE. Otherwise the score weighs the snake's Voronoi territory
+    against the best opponent's, its length against the longest opponent, how many opponents
+    are left, and penalizes low health and territory too small to hold the body.
+    */
+    static int scoreSnake(const Board& board, const std::array<int, MAX_SNAKES>& territory, int subject) {
+        const SnakeStore& snakes = board.m_snakes;
+        if (!snakes.alive[subject]) {
+            return -WIN_SCORE;
+        }
+        int opponents = 0;
+        int best_territory = 0;
+        int best_length = 0;
+        for (int s=0; s<snakes.count; s++) {
+            if (s == subject || !snakes.alive[s]) {continue;}
+            opponents++;
+            best_territory = std::max(best_territory, territory[s]);
+            best_length = std::max(best_length, snakes.lengths[s]);
+        }
+        int score = (territory[subject] - best_territory) * TERRITORY_WEIGHT;
+        if (opponents > 0) {
+            score += (snakes.lengths[subject] - best_length) * LENGTH_WEIGHT;
+        }
+        score -= opponents * OPPONENT_PENALTY;
+        if (territory[subject] < snakes.lengths[subject]) {
+            score -= TRAPPED_PENALTY;
+        }
+        if (snakes.health[subject] < LOW_HEALTH) {
+            score -= (LOW_HEALTH - snakes.health[subject]) * LOW_HEALTH_WEIGHT;
+        }
+        return score;
+    }
+
+    int evaluate(const Board& board, int subject) {
+        if (!board.m_snakes.alive[subject]) {
+            return -WIN_SCORE;
+        }
+        return scoreSnake(board, voronoiTerritory(board), subject);
+    }
+
+    int quickEvaluate(const Board& board, int subject) {
+        const SnakeStore& snakes = board.m_snakes;
+        if (!snakes.alive[subject]) {
+            return -WIN_SCORE;
+        }
+        const int reach = board.floodFill(board.toCoord(snakes.heads[subject]), QUICK_REACH_TURNS);
+        int score = reach * TERRITORY_WEIGHT;
+        int best_length = 0;
+        for (int s=0; s<snakes.count; s++) {
+            if (s != subject && snakes.alive[s]) {
+                score -= OPPONENT_PENALTY;
+                best_length = std::max(best_length, snakes.lengths[s]);
+            }
+        }
+        if (best_length > 0) {
+            score += (snakes.lengths[subject] - best_length) * LENGTH_WEIGHT;
+        }
+        if (reach < snakes.lengths[subject]) {
+            score -= TRAPPED_PENALTY;
+        }
+        if (snakes.health[subject] < LOW_HEALTH) {
+            score -= (LOW_HEALTH - snakes.health[subject]) * LOW_HEALTH_WEIGHT;
+        }
+        return score;
+    }
+
+    std::array<int, MAX_SNAKES> evaluateAll(const Board& board) {
+        const std::array<int, MAX_SNAKES> territory = voronoiTerritory(board);
+        std::array<int, MAX_SNAKES> scores{};
+        for (int s=0; s<board.m_snakes.count; s++) {
+            scores[s] = scoreSnake(board, territory, s);
+        }
+        return scores;
+    }
+} // battlesnake
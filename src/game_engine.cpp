@@ -0,0 +1,247 @@
+#include "game_engine.h"
+#include "movegen.h"
+#include <bit>
+#include <iostream>
+
+namespace battlesnake {
+    //Snakes that vanished since the last answer, each of whose moves has to be guessed
+    constexpr int MAX_VANISHED_SNAKES = 4;
+
+    GameEngine::GameEngine(
+        const EngineConfig& config, const Rules& rules, TranspositionTable& table, std::atomic<int>& choosing, int snakes
+    ):
+        m_config(config), m_rules(rules), m_table(table), m_choosing(choosing), m_endgame(rules), m_beam(rules)
+    {
+        //Arenas are allocated once per game and reused every turn
+        if (m_config.mode != EngineMode::Mcts) {return;}
+        if (m_config.mcts_parallelism == MctsParallelism::Tree) {
+            m_shared_tree = std::make_unique<TreeParallelMcts>(m_rules, policy(), MctsSearch::DEFAULT_MAX_NODES, snakes);
+        } else {
+            m_trees = makeRootParallelTrees(m_rules, policy(), m_config.searchThreads(), snakes);
+        }
+    }
+
+    GameEngine::~GameEngine() {
+        stopPondering();
+    }
+
+    PlayoutPolicy& GameEngine::policy() {
+        if (m_config.rollout == RolloutMode::Random) {
+            return m_random_rollout;
+        }
+        return m_evaluation;
+    }
+
+    //True when both boards hold the same living snakes, matched by ID, with identical bodies and health
+    static bool sameSnakes(const Board& ours, const Board& theirs) {
+        if (ours.aliveCount() != theirs.aliveCount()) {return false;}
+        for (int s=0; s<ours.m_snakes.count; s++) {
+            if (!ours.m_snakes.alive[s]) {continue;}
+            const int t = theirs.snakeIndex(ours.snakeInfo(s).m_id);
+            if (t == -1 || !theirs.m_snakes.alive[t]
+                || ours.m_snakes.health[s] != theirs.m_snakes.health[t]
+                || ours.m_snakes.lengths[s] != theirs.m_snakes.lengths[t]) {
+                return false;
+            }
+            if (ours.m_snakes.bodies[s] != theirs.m_snakes.bodies[t]) {return false;}
+        }
+        return true;
+    }
+
+    /*
+    Finds the joint move that turns the last answered position into current. A surviving snake's
+    move is read off its new head; a snake missing from current died, so each of its candidate
+    moves is tried until stepping the rules reproduces every snake exactly. Returns the stepped
+    board with current's food and hazards, or nothing when current does not follow.
+    */
+    std::optional<Board> GameEngine::followingBoard(const Board& current, JointMove& played) const {
+        const Board& previous = *m_root;
+        MoveMasks masks{};
+        //A snake that vanished may have died on any move, into a body or off the board included
+        MoveList any_move;
+        for (int d=0; d<NUM_DIRECTIONS; d++) {
+            any_move.push(static_cast<Direction>(d));
+        }
+        uint32_t vanished = 0;
+        for (int s=0; s<previous.m_snakes.count; s++) {
+            if (!previous.m_snakes.alive[s]) {continue;}
+            const int t = current.snakeIndex(previous.snakeInfo(s).m_id);
+            if (t == -1) {
+                if (std::popcount(vanished) == MAX_VANISHED_SNAKES) {return std::nullopt;}
+                vanished |= uint32_t{1} << s;
+                masks[s] = directionBit(Direction::Up);
+                continue;
+            }
+            for (int d=0; d<NUM_DIRECTIONS; d++) {
+                const Direction direction = static_cast<Direction>(d);
+                if (previous.m_neighbor_table->step(previous.m_snakes.heads[s], direction) == current.m_snakes.heads[t]) {
+                    masks[s] = directionBit(direction);
+                }
+            }
+            if (masks[s] == 0) {return std::nullopt;}
+        }
+        JointMoveIterator it(previous, masks);
+        for (int s=0; s<previous.m_snakes.count; s++) {
+            if (vanished & (uint32_t{1} << s)) {
+                it.setMoves(s, any_move);
+            }
+        }
+        //One copy tries every candidate, each step undone before the next
+        Board next = previous;
+        for (; !it.done(); it.next()) {
+            const UndoRecord record = m_rules.step(next, it.current());
+            if (sameSnakes(next, current)) {
+                next.copyItems(current);
+                played = it.current();
+                return next;
+            }
+            m_rules.undo(next, record);
+        }
+        return std::nullopt;
+    }
+
+    //Moves the trees down to the position reached, or starts them over; returns true if they were kept
+    bool GameEngine::prepareTrees(const Board& root, const JointMove* played) {
+        if (m_config.mcts_parallelism == MctsParallelism::Tree) {
+            m_shared_tree->restrictRoot(-1);
+            if (played != nullptr && m_shared_tree->adopt(*played)) {return true;}
+            m_shared_tree->reset(root);
+            return false;
+        }
+        bool kept = played != nullptr;
+        for (std::unique_ptr<MctsSearch>& tree : m_trees) {
+            tree->restrictRoot(-1);
+            if (played == nullptr || !tree->adopt(*played)) {
+                tree->reset(root);
+                kept = false;
+            }
+        }
+        return kept;
+    }
+
+    SearchResult GameEngine::chooseMove(const Board& board, const std::string& you_id, SearchClock::time_point deadline) {
+        //Every game's pondering makes way until this move is chosen
+        m_choosing.fetch_add(1, std::memory_order_relaxed);
+        struct Choosing {
+            std::atomic<int>& count;
+            ~Choosing() {count.fetch_sub(1, std::memory_order_relaxed);}
+        } choosing{m_choosing};
+        std::lock_guard<std::mutex> lock(m_mutex);
+        stopPondering();
+        JointMove played;
+        std::optional<Board> root;
+        if (m_root) {
+            root = followingBoard(board, played);
+        }
+        const bool follows = root.has_value();
+        if (!follows) {
+            root.emplace(board);
+        }
+        m_root.reset();
+        const int subject = root->snakeIndex(you_id);
+        if (subject == -1 || !root->m_snakes.alive[subject]) {
+            return SearchResult();
+        }
+
+        SearchLimits limits;
+        limits.deadline = deadline;
+        limits.opponents = opponentFilter();
+        SearchResult result;
+        if (m_config.mode == EngineMode::Mcts && prepareTrees(*root, follows ? &played : nullptr)) {
+            std::cout << "Continuing the search tree from the previous turn" << std::endl;
+        }
+        const EndgameResult endgame = m_endgame.solve(*root, subject);
+        if (endgame.solved) {
+            std::cout << "Endgame solved in " << endgame.nodes << " nodes, "
+                << (endgame.proven ? (endgame.score > 0 ? "won" : "lost") : "sealed off") << " in " << endgame.turns << " turns" << std::endl;
+            result.move = endgame.move;
+            result.score = endgame.score;
+            result.depth = endgame.turns;
+            result.nodes = endgame.nodes;
+        } else if (usesBeam(deadline)) {
+            result = m_beam.search(*root, subject, limits);
+        } else if (m_config.mode == EngineMode::Mcts) {
+            if (m_config.mcts_parallelism == MctsParallelism::Tree) {
+                result = m_shared_tree->run(*root, subject, limits, m_config.searchThreads());
+            } else {
+                result = runRootParallel(m_trees, *root, subject, limits);
+            }
+        } else if (usesMaxn(*root)) {
+            result = MaxnSearch(m_rules).search(*root, subject, limits);
+        } else {
+            result = lazySmpSearch(m_rules, m_table, *root, subject, limits, m_config.searchThreads());
+        }
+        m_root = std::move(root);
+        m_subject = subject;
+        m_our_move = result.move;
+        return result;
+    }
+
+    //Paranoid search is too timid and too slow once several opponents move at the same time
+    bool GameEngine::usesMaxn(const Board& board) const {
+        return m_config.maxn_snakes > 0 && board.aliveCount() >= m_config.maxn_snakes;
+    }
+
+    //Latency matters more than depth when the budget is this short
+    bool GameEngine::usesBeam(SearchClock::time_point deadline) const {
+        return m_config.beam_below_ms > 0
+            && deadline - SearchClock::now() < std::chrono::milliseconds(m_config.beam_below_ms);
+    }
+
+    OpponentFilter GameEngine::opponentFilter() const {
+        OpponentFilter filter;
+        filter.radius = m_config.opponent_radius;
+        filter.max_snakes = m_config.max_opponents;
+        return filter;
+    }
+
+    void GameEngine::startPondering(int timeout_ms) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        stopPondering();
+        if (!m_root) {return;}
+        const SearchClock::time_point until = SearchClock::now() + std::chrono::milliseconds(timeout_ms) * PONDER_TIMEOUTS;
+        m_ponder_stop.store(false, std::memory_order_relaxed);
+        m_ponder_thread = std::thread([this, until]() {ponder(until);});
+    }
+
+    void GameEngine::stopPondering() {
+        if (m_ponder_thread.joinable()) {
+            m_ponder_stop.store(true, std::memory_order_relaxed);
+            m_ponder_thread.join();
+        }
+    }
+
+    /*
+    MCTS grows its trees below our move, so every reply the opponents may pick gets explored.
+    Alpha-beta has no tree to keep and searches the position after the likeliest reply instead,
+    leaving what it finds in the transposition table.
+    */
+    void GameEngine::ponder(SearchClock::time_point until) {
+        SearchLimits limits;
+        limits.deadline = until;
+        limits.stop = &m_ponder_stop;
+        limits.yield = &m_choosing;
+        limits.opponents = opponentFilter();
+        const Board& root = *m_root;
+        if (m_config.mode == EngineMode::Mcts) {
+            if (m_config.mcts_parallelism == MctsParallelism::Tree) {
+                m_shared_tree->restrictRoot(m_subject, m_our_move);
+                m_shared_tree->run(root, m_subject, limits, m_config.ponderThreads());
+            } else {
+                for (std::unique_ptr<MctsSearch>& tree : m_trees) {
+                    tree->restrictRoot(m_subject, m_our_move);
+                }
+                runRootParallel(m_trees, root, m_subject, limits, m_config.ponderThreads());
+            }
+            return;
+        }
+        JointMoveIterator replies(root);
+        replies.fix(m_subject, m_our_move);
+        Board predicted = root;
+        m_rules.step(predicted, replies.current());
+        //Max^n keeps nothing between searches, so there is nothing to ponder for it
+        if (predicted.m_snakes.alive[m_subject] && !usesMaxn(predicted)) {
+            lazySmpSearch(m_rules, m_table, predicted, m_subject, limits, m_config.ponderThreads());
+        }
+    }
+} // battlesnake
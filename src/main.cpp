@@ -1,4 +1,5 @@
 #include "battlesnake.h"
+#include "bench.h"
 #include "httplib.h"
 #include "json.h"
 #include <iostream>
@@ -7,15 +8,35 @@
 using json = nlohmann::json;
 
 int main(int argc, char *argv[]) {
+    //"bench [depth]" prints fixed-depth search node counts and exits
+    if (argc > 1 && std::string(argv[1]) == "bench") {
+        battlesnake::runBench(argc > 2 ? std::stoi(argv[2]) : battlesnake::DEFAULT_BENCH_DEPTH, std::cout);
+        return 0;
+    }
+    //"selfcheck [games]" plays random games checking step and undo against parsed positions
+    if (argc > 1 && std::string(argv[1]) == "selfcheck") {
+        const int games = argc > 2 ? std::stoi(argv[2]) : battlesnake::DEFAULT_SELFCHECK_GAMES;
+        return battlesnake::runSelfCheck(games, std::cout) == 0 ? 0 : 1;
+    }
+    //Options look like --engine=mcts, any other argument is the port
     int port_num = -1;
-    if (argc > 1) {
-        port_num = std::stoi(argv[1]);
+    battlesnake::EngineConfig config;
+    for (int i=1; i<argc; i++) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--", 0) == 0) {
+            try {
+                config.parseOption(arg);
+            } catch (const std::invalid_argument& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        } else {
+            port_num = std::stoi(arg);
+        }
     }
-    battlesnake::BattleSnake bs{};
+    battlesnake::BattleSnake bs{config};
     httplib::Server server;
 
-    srand(time(NULL));
-
     std::string const SERVER_ID = "bgaechter/battlesnake-starter-cpp";
 
     server.set_post_routing_handler([&SERVER_ID](const auto &req [[maybe_unused]], auto &res) {
@@ -47,18 +68,21 @@ int main(int argc, char *argv[]) {
     });
 
     server.Post("/start", [&bs](const httplib::Request &req, httplib::Response &res) {
-        auto state = json::parse(req.body);
-        res.set_content(bs.start(), "text/plain");
+        auto const state = json::parse(req.body);
+        res.set_content(bs.start(state), "text/plain");
     });
 
     server.Post("/move", [&bs](const httplib::Request &req, httplib::Response &res) {
+        //Taken first so the move deadline also covers parsing
+        auto const arrival = battlesnake::SearchClock::now();
         auto const state = json::parse(req.body);
-        const auto response = bs.make_move(state);
+        const auto response = bs.make_move(state, arrival);
         res.set_content(response, "application/json");
     });
 
-    server.Post("/end", [&bs](const httplib::Request &req [[maybe_unused]], httplib::Response &res) {
-        res.set_content(bs.end(), "text/plain");
+    server.Post("/end", [&bs](const httplib::Request &req, httplib::Response &res) {
+        auto const state = json::parse(req.body);
+        res.set_content(bs.end(state), "text/plain");
     });
     if (port_num == -1) {
         std::cout << "Server listening at http://127.0.0.1:8080" << std::endl;
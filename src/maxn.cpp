@@ -0,0 +1,138 @@
+#include "maxn.h"
+#include "evaluation.h"
+#include "movegen.h"
+#include <algorithm>
+#include <cmath>
+
+namespace battlesnake {
+    //Nodes between deadline checks
+    constexpr uint64_t TIME_CHECK_INTERVAL = 256;
+    //Evaluation difference that gives one snake e times the share of another
+    constexpr double SHARE_SCALE = 400.0;
+
+    MaxnSearch::MaxnSearch(const Rules& rules): m_rules(rules) {}
+
+    bool MaxnSearch::timeUp() {
+        if (m_nodes % TIME_CHECK_INTERVAL == 0) {
+            if (SearchClock::now() >= m_limits.deadline || m_limits.stopSignalled()) {
+                m_stopped = true;
+            }
+        }
+        return m_stopped;
+    }
+
+    //Softmax of the evaluations over the living snakes; a lone survivor takes everything
+    MaxnSearch::Values MaxnSearch::leafValues() const {
+        const SnakeStore& snakes = m_board->m_snakes;
+        Values values{};
+        if (m_board->aliveCount() <= 1) {
+            for (int s=0; s<snakes.count; s++) {
+                values[s] = snakes.alive[s] ? 1 : 0;
+            }
+            return values;
+        }
+        const std::array<int, MAX_SNAKES> scores = evaluateAll(*m_board);
+        int top = -INFINITE_SCORE;
+        for (int s=0; s<snakes.count; s++) {
+            if (snakes.alive[s]) {
+                top = std::max(top, scores[s]);
+            }
+        }
+        double total = 0;
+        for (int s=0; s<snakes.count; s++) {
+            if (snakes.alive[s]) {
+                values[s] = std::exp((scores[s] - top) / SHARE_SCALE);
+                total += values[s];
+            }
+        }
+        for (int s=0; s<snakes.count; s++) {
+            values[s] /= total;
+        }
+        return values;
+    }
+
+    /*
+    Move choice of the mover-th snake of the turn at ply. bound is what the snake choosing before
+    it has already secured; once this snake's best reaches 1 - bound that snake will not come
+    here, so the remaining moves are skipped.
+    */
+    MaxnSearch::Values MaxnSearch::chooseNode(int depth, int ply, int mover, double bound) {
+        const SnakeStore& snakes = m_board->m_snakes;
+        if (mover == 0) {
+            m_nodes++;
+            if (timeUp()) {return Values{};}
+            if (!snakes.alive[m_subject] || m_board->aliveCount() <= 1 || depth == 0) {
+                return leafValues();
+            }
+            m_moves[ply].fill(Direction::Up);
+            m_masks[ply] = m_limits.opponents.masks(*m_board, m_subject);
+            m_movers[ply] = 0;
+            m_order[ply][m_movers[ply]++] = static_cast<int8_t>(m_subject);
+            for (int s=0; s<snakes.count; s++) {
+                if (s != m_subject && snakes.alive[s]) {
+                    m_order[ply][m_movers[ply]++] = static_cast<int8_t>(s);
+                }
+            }
+        }
+        const int snake = m_order[ply][mover];
+        const bool root = ply == 0 && mover == 0;
+        MoveList moves = orderedMoves(*m_board, snake, m_masks[ply][snake]);
+        if (root) {
+            //The previous iteration's best move first
+            moves.moveToFront(m_root_move);
+        }
+        Values best{};
+        bool found = false;
+        for (Direction move : moves) {
+            m_moves[ply][snake] = move;
+            const double own = found ? best[snake] : 0;
+            Values values;
+            if (mover + 1 < m_movers[ply]) {
+                values = chooseNode(depth, ply, mover + 1, own);
+            } else {
+                const UndoRecord record = m_rules.step(*m_board, m_moves[ply]);
+                values = chooseNode(depth - 1, ply + 1, 0, own);
+                m_rules.undo(*m_board, record);
+            }
+            if (m_stopped) {return Values{};}
+            if (!found || values[snake] > best[snake]) {
+                best = values;
+                found = true;
+                if (root) {
+                    m_root_move = move;
+                }
+            }
+            if (best[snake] >= 1 - bound) {break;}
+        }
+        return best;
+    }
+
+    SearchResult MaxnSearch::search(const Board& root, int subject, const SearchLimits& limits) {
+        Board board = root;
+        m_board = &board;
+        m_subject = subject;
+        m_limits = limits;
+        m_nodes = 0;
+        m_stopped = false;
+
+        SearchResult result;
+        const MoveList root_moves = orderedMoves(board, subject, legalMoves(board, subject));
+        result.move = root_moves[0];
+        if (root_moves.size() == 1) {
+            result.depth = 1;
+            return result;
+        }
+        m_root_move = root_moves[0];
+        const int max_depth = std::min(limits.max_depth, MAX_SEARCH_PLY);
+        for (int depth=1; depth<=max_depth; depth++) {
+            const Values values = chooseNode(depth, 0, 0, 0);
+            if (m_stopped) {break;}
+            result.move = m_root_move;
+            result.score = static_cast<int>(1000 * values[subject]);
+            result.depth = depth;
+        }
+        result.nodes = m_nodes;
+        m_board = nullptr;
+        return result;
+    }
+} // battlesnake
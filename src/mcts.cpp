@@ -0,0 +1,644 @@
+#include "mcts.h"
+#include "evaluation.h"
+#include <bit>
+#include <cmath>
+#include <thread>
+
+namespace battlesnake {
+    //Exploration constant of UCB1 for values in [0, 1]
+    constexpr double EXPLORATION = 1.0;
+    //Evaluation difference that moves a snake's value from 0.5 to about 0.73
+    constexpr double EVAL_SCALE = 400.0;
+    //Iterations between deadline checks
+    constexpr uint64_t TIME_CHECK_INTERVAL = 16;
+    //Smallest tree a root-parallel worker gets when the node budget is split between threads
+    constexpr size_t MIN_THREAD_NODES = 1 << 14;
+
+    //True once the deadline has passed or another thread asked the search to stop
+    static bool stopRequested(const SearchLimits& limits) {
+        return SearchClock::now() >= limits.deadline || limits.stopSignalled();
+    }
+
+    //Key of the child a joint move leads to; snakes without moves at the node take no part
+    static uint32_t jointKey(const std::array<MoveList, MAX_SNAKES>& node_moves, const JointMove& moves) {
+        uint32_t key = 0;
+        for (int s=0; s<MAX_SNAKES; s++) {
+            if (!node_moves[s].empty()) {
+                key |= static_cast<uint32_t>(moves[s]) << (2 * s);
+            }
+        }
+        return key;
+    }
+
+    //Position of move in the list, or -1 if it is not a candidate
+    static int moveIndex(const MoveList& moves, Direction move) {
+        for (int i=0; i<moves.size(); i++) {
+            if (moves[i] == move) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    bool decidedValues(const Board& board, SnakeValues& values) {
+        const int alive = board.aliveCount();
+        if (alive > 1 || (alive == 1 && board.m_snakes.count == 1)) {
+            return false;
+        }
+        values.fill(0);
+        for (int s=0; s<board.m_snakes.count; s++) {
+            if (board.m_snakes.alive[s]) {
+                values[s] = 1;
+            }
+        }
+        return true;
+    }
+
+    SnakeValues EvaluationPolicy::evaluate(Board& board, const Rules&, Rng&) {
+        const std::array<int, MAX_SNAKES> scores = evaluateAll(board);
+        SnakeValues values{};
+        for (int s=0; s<board.m_snakes.count; s++) {
+            if (board.m_snakes.alive[s]) {
+                values[s] = 1.0 / (1.0 + std::exp(-scores[s] / EVAL_SCALE));
+            }
+        }
+        return values;
+    }
+
+    SnakeValues RandomRolloutPolicy::evaluate(Board& board, const Rules& rules, Rng& rng) {
+        std::array<UndoRecord, MAX_TURNS> records;
+        SnakeValues values;
+        int turns = 0;
+        bool decided = decidedValues(board, values);
+        while (!decided && turns < MAX_TURNS) {
+            JointMove moves;
+            moves.fill(Direction::Up);
+            for (int s=0; s<board.m_snakes.count; s++) {
+                MoveMask legal = legalMoves(board, s);
+                if (legal == 0) {continue;}
+                //Drop a random number of low bits to land on a uniformly chosen legal move
+                for (int skip=rng.below(std::popcount(legal)); skip>0; skip--) {
+                    legal &= legal - 1;
+                }
+                moves[s] = static_cast<Direction>(std::countr_zero(legal));
+            }
+            records[turns++] = rules.step(board, moves);
+            decided = decidedValues(board, values);
+        }
+        if (!decided) {
+            values = EvaluationPolicy().evaluate(board, rules, rng);
+        }
+        while (turns > 0) {
+            rules.undo(board, records[--turns]);
+        }
+        return values;
+    }
+
+    MctsSearch::MctsSearch(const Rules& rules, PlayoutPolicy& policy, uint64_t seed, size_t max_nodes, int snakes):
+        m_rules(rules), m_policy(policy), m_rng(seed), m_max_nodes(max_nodes),
+        m_max_stats(max_nodes * snakes * NUM_DIRECTIONS)
+    {
+        m_nodes.reserve(m_max_nodes);
+        m_stats.reserve(m_max_stats);
+    }
+
+    uint32_t MctsSearch::newNode(const Board& board, uint32_t joint_key) {
+        Node node;
+        node.joint_key = joint_key;
+        node.stats = static_cast<uint32_t>(m_stats.size());
+        for (int s=0; s<board.m_snakes.count; s++) {
+            node.moves[s] = MoveList();
+            if (board.m_snakes.alive[s]) {
+                node.moves[s] = orderedMoves(board, s, legalMoves(board, s));
+            }
+            m_stats.resize(m_stats.size() + node.moves[s].size());
+        }
+        m_nodes.push_back(node);
+        return static_cast<uint32_t>(m_nodes.size() - 1);
+    }
+
+    uint32_t MctsSearch::findChild(uint32_t node, uint32_t joint_key) const {
+        for (uint32_t child = m_nodes[node].first_child; child != NO_NODE; child = m_nodes[child].next_sibling) {
+            if (m_nodes[child].joint_key == joint_key) {
+                return child;
+            }
+        }
+        return NO_NODE;
+    }
+
+    uint32_t MctsSearch::statsOffset(const Node& node, int snake) const {
+        uint32_t offset = node.stats;
+        for (int s=0; s<snake; s++) {
+            offset += node.moves[s].size();
+        }
+        return offset;
+    }
+
+    //UCB1 over one snake's own move statistics, trying every move once first
+    template<class Visits, class Value>
+    static int selectUcb(int count, uint32_t parent_visits, Visits visits, Value value) {
+        const double log_visits = std::log(static_cast<double>(std::max<uint32_t>(parent_visits, 1)));
+        int best = 0;
+        double best_ucb = -1;
+        for (int i=0; i<count; i++) {
+            const uint32_t n = visits(i);
+            if (n == 0) {
+                return i;
+            }
+            const double ucb = value(i) / n + EXPLORATION * std::sqrt(log_visits / n);
+            if (ucb > best_ucb) {
+                best_ucb = ucb;
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    int MctsSearch::selectMove(const Node& node, int snake) const {
+        const MoveStats* stats = &m_stats[statsOffset(node, snake)];
+        return selectUcb(
+            node.moves[snake].size(), node.visits,
+            [stats](int i) {return stats[i].visits;},
+            [stats](int i) {return static_cast<double>(stats[i].value);}
+        );
+    }
+
+    //Selects down to a leaf, expands it, scores it with the playout policy and backs the values up
+    void MctsSearch::iterate(Board& board) {
+        m_path.clear();
+        uint32_t node = 0;
+        SnakeValues values;
+        while (true) {
+            if (decidedValues(board, values)) {break;}
+            if (m_nodes[node].visits == 0) {
+                values = m_policy.evaluate(board, m_rules, m_rng);
+                break;
+            }
+            PathStep step;
+            step.node = node;
+            JointMove moves;
+            moves.fill(Direction::Up);
+            uint32_t joint_key = 0;
+            const Node& current = m_nodes[node];
+            for (int s=0; s<board.m_snakes.count; s++) {
+                if (current.moves[s].empty()) {continue;}
+                int choice = node == 0 && s == m_root_snake ? moveIndex(current.moves[s], m_root_move) : -1;
+                if (choice < 0) {
+                    choice = selectMove(current, s);
+                }
+                step.choices[s] = static_cast<uint8_t>(choice);
+                moves[s] = current.moves[s][choice];
+                joint_key |= static_cast<uint32_t>(moves[s]) << (2 * s);
+            }
+            step.record = m_rules.step(board, moves);
+            m_path.push_back(step);
+            uint32_t child = findChild(node, joint_key);
+            if (child == NO_NODE) {
+                if (m_nodes.size() >= m_max_nodes
+                    || m_stats.size() + static_cast<size_t>(board.m_snakes.count) * NUM_DIRECTIONS > m_max_stats) {
+                    //Arena is full, keep scoring leaves without growing the tree
+                    values = m_policy.evaluate(board, m_rules, m_rng);
+                    node = NO_NODE;
+                    break;
+                }
+                child = newNode(board, joint_key);
+                m_nodes[child].next_sibling = m_nodes[node].first_child;
+                m_nodes[node].first_child = child;
+            }
+            node = child;
+        }
+        if (node != NO_NODE) {
+            m_nodes[node].visits++;
+        }
+        m_max_depth = std::max(m_max_depth, static_cast<int>(m_path.size()));
+        for (auto step = m_path.rbegin(); step != m_path.rend(); ++step) {
+            Node& current = m_nodes[step->node];
+            current.visits++;
+            for (int s=0; s<board.m_snakes.count; s++) {
+                if (current.moves[s].empty()) {continue;}
+                MoveStats& stats = m_stats[statsOffset(current, s) + step->choices[s]];
+                stats.visits++;
+                stats.value += static_cast<float>(values[s]);
+            }
+            m_rules.undo(board, step->record);
+        }
+    }
+
+    RootStats MctsSearch::rootStats(int snake) const {
+        RootStats totals;
+        if (m_nodes.empty()) {return totals;}
+        const Node& root = m_nodes[0];
+        const MoveStats* stats = &m_stats[statsOffset(root, snake)];
+        for (int i=0; i<root.moves[snake].size(); i++) {
+            const int d = static_cast<int>(root.moves[snake][i]);
+            totals.visits[d] += stats[i].visits;
+            totals.value[d] += stats[i].value;
+        }
+        return totals;
+    }
+
+    //Plays the most visited move; the score is its mean value scaled to 0..1000
+    static void pickMostVisited(const RootStats& stats, SearchResult& result) {
+        uint64_t best_visits = 0;
+        for (int d=0; d<NUM_DIRECTIONS; d++) {
+            if (stats.visits[d] > best_visits) {
+                best_visits = stats.visits[d];
+                result.move = static_cast<Direction>(d);
+                result.score = static_cast<int>(1000 * stats.value[d] / stats.visits[d]);
+            }
+        }
+    }
+
+    void MctsSearch::reset(const Board& root) {
+        m_nodes.clear();
+        m_stats.clear();
+        newNode(root, 0);
+    }
+
+    void MctsSearch::restrictRoot(int snake, Direction move) {
+        m_root_snake = snake;
+        m_root_move = move;
+    }
+
+    bool MctsSearch::adopt(const JointMove& moves) {
+        if (m_nodes.empty()) {return false;}
+        const uint32_t child = findChild(0, jointKey(m_nodes[0].moves, moves));
+        if (child == NO_NODE) {return false;}
+        m_spare_nodes.clear();
+        m_spare_stats.clear();
+        m_spare_nodes.push_back(m_nodes[child]);
+        //Breadth-first copy: a copied node keeps its old child links until the loop reaches it
+        for (size_t i=0; i<m_spare_nodes.size(); i++) {
+            const uint32_t old_stats = m_spare_nodes[i].stats;
+            const uint32_t stats_count = statsOffset(m_spare_nodes[i], MAX_SNAKES) - old_stats;
+            m_spare_nodes[i].stats = static_cast<uint32_t>(m_spare_stats.size());
+            m_spare_stats.insert(m_spare_stats.end(), m_stats.begin() + old_stats, m_stats.begin() + old_stats + stats_count);
+            uint32_t previous = NO_NODE;
+            uint32_t old_child = m_spare_nodes[i].first_child;
+            m_spare_nodes[i].first_child = NO_NODE;
+            for (; old_child != NO_NODE; old_child = m_nodes[old_child].next_sibling) {
+                const uint32_t copy = static_cast<uint32_t>(m_spare_nodes.size());
+                m_spare_nodes.push_back(m_nodes[old_child]);
+                m_spare_nodes[copy].next_sibling = NO_NODE;
+                if (previous == NO_NODE) {
+                    m_spare_nodes[i].first_child = copy;
+                } else {
+                    m_spare_nodes[previous].next_sibling = copy;
+                }
+                previous = copy;
+            }
+        }
+        m_spare_nodes[0].joint_key = 0;
+        std::swap(m_nodes, m_spare_nodes);
+        std::swap(m_stats, m_spare_stats);
+        m_nodes.reserve(m_max_nodes);
+        m_stats.reserve(m_max_stats);
+        return true;
+    }
+
+    SearchResult MctsSearch::search(const Board& root, int subject, const SearchLimits& limits) {
+        reset(root);
+        return run(root, subject, limits);
+    }
+
+    /*
+    Runs iterations until the deadline and plays our most visited root move. Depth is the
+    deepest path selected and nodes the number of iterations.
+    */
+    SearchResult MctsSearch::run(const Board& root, int subject, const SearchLimits& limits) {
+        Board board = root;
+        m_max_depth = 0;
+
+        SearchResult result;
+        const Node& root_node = m_nodes[0];
+        result.move = root_node.moves[subject][0];
+        if (root_node.moves[subject].size() == 1 && m_root_snake != subject) {
+            result.depth = 1;
+            return result;
+        }
+        uint64_t iterations = 0;
+        while (iterations % TIME_CHECK_INTERVAL != 0 || !stopRequested(limits)) {
+            iterate(board);
+            iterations++;
+        }
+        pickMostVisited(rootStats(subject), result);
+        result.depth = m_max_depth;
+        result.nodes = iterations;
+        return result;
+    }
+
+    SearchResult rootParallelMctsSearch(
+        const Rules& rules, PlayoutPolicy& policy, const Board& root, int subject,
+        const SearchLimits& limits, int threads
+    ) {
+        std::vector<std::unique_ptr<MctsSearch>> trees = makeRootParallelTrees(rules, policy, threads, root.m_snakes.count);
+        for (std::unique_ptr<MctsSearch>& tree : trees) {
+            tree->reset(root);
+        }
+        return runRootParallel(trees, root, subject, limits);
+    }
+
+    std::vector<std::unique_ptr<MctsSearch>> makeRootParallelTrees(
+        const Rules& rules, PlayoutPolicy& policy, int threads, int snakes
+    ) {
+        threads = std::max(1, threads);
+        const size_t max_nodes = threads == 1
+            ? MctsSearch::DEFAULT_MAX_NODES
+            : std::max<size_t>(MctsSearch::DEFAULT_MAX_NODES / threads, MIN_THREAD_NODES);
+        std::vector<std::unique_ptr<MctsSearch>> trees;
+        for (int i=0; i<threads; i++) {
+            trees.push_back(std::make_unique<MctsSearch>(rules, policy, threadRng().next(), max_nodes, snakes));
+        }
+        return trees;
+    }
+
+    SearchResult runRootParallel(
+        std::vector<std::unique_ptr<MctsSearch>>& trees, const Board& root, int subject, const SearchLimits& limits,
+        int threads
+    ) {
+        threads = threads > 0 ? std::min(threads, static_cast<int>(trees.size())) : static_cast<int>(trees.size());
+        std::vector<SearchResult> results(threads);
+        std::vector<RootStats> stats(threads);
+        auto worker = [&](int i) {
+            results[i] = trees[i]->run(root, subject, limits);
+            stats[i] = trees[i]->rootStats(subject);
+        };
+        std::vector<std::thread> workers;
+        for (int i=1; i<threads; i++) {
+            workers.emplace_back(worker, i);
+        }
+        worker(0);
+        for (std::thread& thread : workers) {
+            thread.join();
+        }
+        RootStats merged;
+        SearchResult result = results[0];
+        result.nodes = 0;
+        for (int i=0; i<threads; i++) {
+            for (int d=0; d<NUM_DIRECTIONS; d++) {
+                merged.visits[d] += stats[i].visits[d];
+                merged.value[d] += stats[i].value[d];
+            }
+            result.depth = std::max(result.depth, results[i].depth);
+            result.nodes += results[i].nodes;
+        }
+        pickMostVisited(merged, result);
+        return result;
+    }
+
+    TreeParallelMcts::TreeParallelMcts(const Rules& rules, PlayoutPolicy& policy, size_t max_nodes, int snakes):
+        m_rules(rules), m_policy(policy), m_max_nodes(max_nodes), m_max_stats(max_nodes * snakes * NUM_DIRECTIONS),
+        m_nodes(new Node[m_max_nodes]), m_stats(new MoveStats[m_max_stats])
+    {}
+
+    //Takes amount from an arena counter unless that would pass capacity, leaving a full arena's count alone
+    static bool claim(std::atomic<uint32_t>& count, uint32_t amount, size_t capacity, uint32_t& start) {
+        uint32_t current = count.load(std::memory_order_relaxed);
+        do {
+            if (current + amount > capacity) {return false;}
+        } while (!count.compare_exchange_weak(current, current + amount, std::memory_order_relaxed));
+        start = current;
+        return true;
+    }
+
+    //Claims a node and its statistics from the arenas, or returns NO_NODE once they are full
+    uint32_t TreeParallelMcts::newNode(const Board& board, uint32_t joint_key) {
+        std::array<MoveList, MAX_SNAKES> moves;
+        uint32_t stats_needed = 0;
+        for (int s=0; s<board.m_snakes.count; s++) {
+            moves[s] = MoveList();
+            if (board.m_snakes.alive[s]) {
+                moves[s] = orderedMoves(board, s, legalMoves(board, s));
+            }
+            stats_needed += moves[s].size();
+        }
+        //The statistics arena holds every move of a full node arena, so it only runs out with it
+        uint32_t index;
+        uint32_t stats;
+        if (!claim(m_node_count, 1, m_max_nodes, index) || !claim(m_stats_count, stats_needed, m_max_stats, stats)) {
+            return NO_NODE;
+        }
+        for (uint32_t i=stats; i<stats+stats_needed; i++) {
+            m_stats[i].visits.store(0, std::memory_order_relaxed);
+            m_stats[i].value.store(0, std::memory_order_relaxed);
+        }
+        Node& node = m_nodes[index];
+        node.first_child.store(NO_NODE, std::memory_order_relaxed);
+        node.next_sibling = NO_NODE;
+        node.joint_key = joint_key;
+        node.stats = stats;
+        node.visits.store(0, std::memory_order_relaxed);
+        node.moves = moves;
+        return index;
+    }
+
+    /*
+    Finds the child reached by joint_key, linking in a new one if no thread has yet. The new node
+    is filled in before a compare-and-swap publishes it at the head of the parent's child list; if
+    another thread got there first the list is scanned again, so each key is linked only once.
+    */
+    uint32_t TreeParallelMcts::findOrExpand(uint32_t parent, uint32_t joint_key, const Board& board, bool& expanded) {
+        expanded = false;
+        std::atomic<uint32_t>& first_child = m_nodes[parent].first_child;
+        uint32_t head = first_child.load(std::memory_order_acquire);
+        uint32_t fresh = NO_NODE;
+        while (true) {
+            for (uint32_t child = head; child != NO_NODE; child = m_nodes[child].next_sibling) {
+                if (m_nodes[child].joint_key == joint_key) {
+                    return child;
+                }
+            }
+            if (fresh == NO_NODE) {
+                fresh = newNode(board, joint_key);
+                if (fresh == NO_NODE) {return NO_NODE;}
+            }
+            m_nodes[fresh].next_sibling = head;
+            if (first_child.compare_exchange_weak(head, fresh, std::memory_order_release, std::memory_order_acquire)) {
+                expanded = true;
+                return fresh;
+            }
+        }
+    }
+
+    uint32_t TreeParallelMcts::statsOffset(const Node& node, int snake) const {
+        uint32_t offset = node.stats;
+        for (int s=0; s<snake; s++) {
+            offset += node.moves[s].size();
+        }
+        return offset;
+    }
+
+    void TreeParallelMcts::iterate(Board& board, Worker& worker) {
+        worker.path.clear();
+        uint32_t node = 0;
+        SnakeValues values;
+        while (true) {
+            Node& current = m_nodes[node];
+            current.visits.fetch_add(1, std::memory_order_relaxed);
+            if (decidedValues(board, values)) {break;}
+            PathStep step;
+            step.node = node;
+            JointMove moves;
+            moves.fill(Direction::Up);
+            uint32_t joint_key = 0;
+            const uint32_t parent_visits = current.visits.load(std::memory_order_relaxed);
+            for (int s=0; s<board.m_snakes.count; s++) {
+                if (current.moves[s].empty()) {continue;}
+                MoveStats* stats = &m_stats[statsOffset(current, s)];
+                int choice = node == 0 && s == m_root_snake ? moveIndex(current.moves[s], m_root_move) : -1;
+                if (choice < 0) {
+                    choice = selectUcb(
+                        current.moves[s].size(), parent_visits,
+                        [stats](int i) {return stats[i].visits.load(std::memory_order_relaxed);},
+                        [stats](int i) {return static_cast<double>(stats[i].value.load(std::memory_order_relaxed));}
+                    );
+                }
+                //Virtual loss: the visit counts now, its value only arrives on the way back
+                stats[choice].visits.fetch_add(1, std::memory_order_relaxed);
+                step.choices[s] = static_cast<uint8_t>(choice);
+                moves[s] = current.moves[s][choice];
+                joint_key |= static_cast<uint32_t>(moves[s]) << (2 * s);
+            }
+            step.record = m_rules.step(board, moves);
+            worker.path.push_back(step);
+            bool expanded;
+            const uint32_t child = findOrExpand(node, joint_key, board, expanded);
+            if (child == NO_NODE || expanded) {
+                if (expanded) {
+                    m_nodes[child].visits.fetch_add(1, std::memory_order_relaxed);
+                }
+                values = m_policy.evaluate(board, m_rules, worker.rng);
+                break;
+            }
+            node = child;
+        }
+        worker.max_depth = std::max(worker.max_depth, static_cast<int>(worker.path.size()));
+        for (auto step = worker.path.rbegin(); step != worker.path.rend(); ++step) {
+            const Node& current = m_nodes[step->node];
+            for (int s=0; s<board.m_snakes.count; s++) {
+                if (current.moves[s].empty()) {continue;}
+                m_stats[statsOffset(current, s) + step->choices[s]].value.fetch_add(
+                    static_cast<float>(values[s]), std::memory_order_relaxed
+                );
+            }
+            m_rules.undo(board, step->record);
+        }
+    }
+
+    void TreeParallelMcts::work(const Board& root, const SearchLimits& limits, Worker& worker) {
+        Board board = root;
+        while (worker.iterations % TIME_CHECK_INTERVAL != 0 || !stopRequested(limits)) {
+            iterate(board, worker);
+            worker.iterations++;
+        }
+    }
+
+    void TreeParallelMcts::reset(const Board& root) {
+        m_node_count.store(0, std::memory_order_relaxed);
+        m_stats_count.store(0, std::memory_order_relaxed);
+        newNode(root, 0);
+    }
+
+    void TreeParallelMcts::restrictRoot(int snake, Direction move) {
+        m_root_snake = snake;
+        m_root_move = move;
+    }
+
+    //Same breadth-first compaction as MctsSearch::adopt, into the spare arenas
+    bool TreeParallelMcts::adopt(const JointMove& moves) {
+        if (m_node_count.load(std::memory_order_relaxed) == 0) {return false;}
+        const uint32_t key = jointKey(m_nodes[0].moves, moves);
+        uint32_t child = m_nodes[0].first_child.load(std::memory_order_relaxed);
+        while (child != NO_NODE && m_nodes[child].joint_key != key) {
+            child = m_nodes[child].next_sibling;
+        }
+        if (child == NO_NODE) {return false;}
+        //Copies everything but the sibling link, which is set once the next sibling is copied
+        auto copy_node = [](const Node& from, Node& to) {
+            to.first_child.store(from.first_child.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            to.next_sibling = NO_NODE;
+            to.joint_key = from.joint_key;
+            to.stats = from.stats;
+            to.visits.store(from.visits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            to.moves = from.moves;
+        };
+        if (!m_spare_nodes) {
+            m_spare_nodes.reset(new Node[m_max_nodes]);
+            m_spare_stats.reset(new MoveStats[m_max_stats]);
+        }
+        uint32_t node_count = 1;
+        uint32_t stats_count = 0;
+        copy_node(m_nodes[child], m_spare_nodes[0]);
+        for (uint32_t i=0; i<node_count; i++) {
+            Node& node = m_spare_nodes[i];
+            const uint32_t stats_needed = statsOffset(node, MAX_SNAKES) - node.stats;
+            for (uint32_t j=0; j<stats_needed; j++) {
+                const MoveStats& from = m_stats[node.stats + j];
+                MoveStats& to = m_spare_stats[stats_count + j];
+                to.visits.store(from.visits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                to.value.store(from.value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            node.stats = stats_count;
+            stats_count += stats_needed;
+            uint32_t previous = NO_NODE;
+            uint32_t old_child = node.first_child.load(std::memory_order_relaxed);
+            node.first_child.store(NO_NODE, std::memory_order_relaxed);
+            for (; old_child != NO_NODE; old_child = m_nodes[old_child].next_sibling) {
+                const uint32_t copy = node_count++;
+                copy_node(m_nodes[old_child], m_spare_nodes[copy]);
+                if (previous == NO_NODE) {
+                    node.first_child.store(copy, std::memory_order_relaxed);
+                } else {
+                    m_spare_nodes[previous].next_sibling = copy;
+                }
+                previous = copy;
+            }
+        }
+        m_spare_nodes[0].joint_key = 0;
+        std::swap(m_nodes, m_spare_nodes);
+        std::swap(m_stats, m_spare_stats);
+        m_node_count.store(node_count, std::memory_order_relaxed);
+        m_stats_count.store(stats_count, std::memory_order_relaxed);
+        return true;
+    }
+
+    SearchResult TreeParallelMcts::search(const Board& root, int subject, const SearchLimits& limits, int threads) {
+        reset(root);
+        return run(root, subject, limits, threads);
+    }
+
+    SearchResult TreeParallelMcts::run(const Board& root, int subject, const SearchLimits& limits, int threads) {
+        SearchResult result;
+        const Node& root_node = m_nodes[0];
+        result.move = root_node.moves[subject][0];
+        if (root_node.moves[subject].size() == 1 && m_root_snake != subject) {
+            result.depth = 1;
+            return result;
+        }
+        std::vector<Worker> workers(std::max(1, threads));
+        for (Worker& worker : workers) {
+            worker.rng = Rng(threadRng().next());
+        }
+        std::vector<std::thread> helpers;
+        for (size_t i=1; i<workers.size(); i++) {
+            helpers.emplace_back([&, i]() {work(root, limits, workers[i]);});
+        }
+        work(root, limits, workers[0]);
+        for (std::thread& helper : helpers) {
+            helper.join();
+        }
+        RootStats totals;
+        const MoveStats* stats = &m_stats[statsOffset(root_node, subject)];
+        for (int i=0; i<root_node.moves[subject].size(); i++) {
+            const int d = static_cast<int>(root_node.moves[subject][i]);
+            totals.visits[d] = stats[i].visits.load(std::memory_order_relaxed);
+            totals.value[d] = stats[i].value.load(std::memory_order_relaxed);
+        }
+        pickMostVisited(totals, result);
+        for (const Worker& worker : workers) {
+            result.depth = std::max(result.depth, worker.max_depth);
+            result.nodes += worker.iterations;
+        }
+        return result;
+    }
+} // battlesnake
@@ -0,0 +1,208 @@
+#include "movegen.h"
+#include <cstdlib>
+
+namespace battlesnake {
+    //True if a snake other than subject on 1 health covers c with a segment that stays next turn
+    static bool onStarvingBody(const Board& board, int subject, Cell c) {
+        const SnakeStore& snakes = board.m_snakes;
+        for (int s=0; s<snakes.count; s++) {
+            if (s == subject || !snakes.alive[s] || snakes.health[s] > 1) {continue;}
+            const BodyRing& body = snakes.bodies[s];
+            if (body.find(c, body.size() - 1) != -1) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    MoveMask legalMoves(const Board& board, int snake) {
+        const SnakeStore& snakes = board.m_snakes;
+        if (!snakes.alive[snake]) {return 0;}
+        const Cell head = snakes.heads[snake];
+        MoveMask mask = 0;
+        for (int d=0; d<NUM_DIRECTIONS; d++) {
+            const Cell c = board.m_neighbor_table->step(head, static_cast<Direction>(d));
+            if (c == NO_CELL) {continue;}
+            if (board.obstacleTimer(c) == 0 || onStarvingBody(board, snake, c)) {
+                mask |= directionBit(static_cast<Direction>(d));
+            }
+        }
+        return mask;
+    }
+
+    MoveMasks legalMoveMasks(const Board& board) {
+        MoveMasks masks{};
+        for (int s=0; s<board.m_snakes.count; s++) {
+            masks[s] = legalMoves(board, s);
+        }
+        return masks;
+    }
+
+    bool headsInContact(const Board& board, int snake) {
+        const SnakeStore& snakes = board.m_snakes;
+        if (!snakes.alive[snake]) {return false;}
+        Bitboard reach;
+        for (Cell n : board.getNeighbors(snakes.heads[snake])) {
+            reach.set(n);
+        }
+        for (int s=0; s<snakes.count; s++) {
+            if (s == snake || !snakes.alive[s]) {continue;}
+            const Cell head = snakes.heads[s];
+            if (reach.test(head)) {return true;}
+            for (Cell n : board.getNeighbors(head)) {
+                if (reach.test(n)) {return true;}
+            }
+        }
+        return false;
+    }
+
+    Direction defaultMove(const Board& board, int snake) {
+        const MoveList moves = orderedMoves(board, snake, legalMoves(board, snake));
+        Direction best = moves.empty() ? Direction::Up : moves[0];
+        int most_free = -1;
+        for (Direction move : moves) {
+            const Cell c = board.m_neighbor_table->step(board.m_snakes.heads[snake], move);
+            if (c == NO_CELL) {continue;}
+            int free = 0;
+            for (Cell n : board.getNeighbors(c)) {
+                free += board.obstacleTimer(n) <= 1;
+            }
+            if (free > most_free) {
+                most_free = free;
+                best = move;
+            }
+        }
+        return best;
+    }
+
+    //Steps between two heads, around the edges on wrapped boards
+    static int headDistance(const Board& board, Cell a, Cell b) {
+        const Coord from = board.toCoord(a);
+        const Coord to = board.toCoord(b);
+        if (!board.m_neighbor_table->wrapped()) {
+            return board.manDist(from, to);
+        }
+        const int dx = std::abs(from.x - to.x);
+        const int dy = std::abs(from.y - to.y);
+        return std::min(dx, board.m_width - dx) + std::min(dy, board.m_height - dy);
+    }
+
+    MoveMasks OpponentFilter::masks(const Board& board, int subject) const {
+        MoveMasks masks = legalMoveMasks(board);
+        const SnakeStore& snakes = board.m_snakes;
+        if (radius <= 0 || board.aliveCount() - 1 <= max_snakes) {return masks;}
+        std::array<std::pair<int, int>, MAX_SNAKES> opponents;
+        int count = 0;
+        for (int s=0; s<snakes.count; s++) {
+            if (s != subject && snakes.alive[s]) {
+                opponents[count++] = {headDistance(board, snakes.heads[subject], snakes.heads[s]), s};
+            }
+        }
+        std::sort(opponents.begin(), opponents.begin() + count);
+        for (int i=0; i<count; i++) {
+            const auto [distance, s] = opponents[i];
+            if ((i >= max_snakes || distance > radius) && masks[s] != 0) {
+                masks[s] = directionBit(defaultMove(board, s));
+            }
+        }
+        return masks;
+    }
+
+    MoveList orderedMoves(const Board& board, int snake, MoveMask legal) {
+        const SnakeStore& snakes = board.m_snakes;
+        const Cell head = snakes.heads[snake];
+        MoveList safe;
+        MoveList contested;
+        for (int d=0; d<NUM_DIRECTIONS; d++) {
+            const Direction direction = static_cast<Direction>(d);
+            if (!(legal & directionBit(direction))) {continue;}
+            const Cell c = board.m_neighbor_table->step(head, direction);
+            bool is_contested = false;
+            for (Cell n : board.getNeighbors(c)) {
+                if (n != head && board.m_head_bits.test(n) && board.m_heads_array[n] >= snakes.lengths[snake]) {
+                    is_contested = true;
+                    break;
+                }
+            }
+            if (is_contested) {
+                contested.push(direction);
+            } else {
+                safe.push(direction);
+            }
+        }
+        for (Direction d : contested) {
+            safe.push(d);
+        }
+        if (safe.empty()) {
+            //Every move loses; prefer one that at least stays on the board
+            Direction forced = Direction::Up;
+            for (int d=0; d<NUM_DIRECTIONS; d++) {
+                if (board.m_neighbor_table->step(head, static_cast<Direction>(d)) != NO_CELL) {
+                    forced = static_cast<Direction>(d);
+                    break;
+                }
+            }
+            safe.push(forced);
+        }
+        return safe;
+    }
+
+    JointMoveIterator::JointMoveIterator(const Board& board):
+        JointMoveIterator(board, legalMoveMasks(board))
+    {}
+
+    JointMoveIterator::JointMoveIterator(const Board& board, const MoveMasks& masks):
+        m_snake_count(board.m_snakes.count)
+    {
+        m_current.fill(Direction::Up);
+        for (int s=0; s<m_snake_count; s++) {
+            m_moves[s] = MoveList();
+            if (board.m_snakes.alive[s]) {
+                m_moves[s] = orderedMoves(board, s, masks[s]);
+            } else {
+                m_moves[s].push(Direction::Up);
+            }
+        }
+        reset();
+    }
+
+    void JointMoveIterator::fix(int snake, Direction move) {
+        m_moves[snake] = MoveList();
+        m_moves[snake].push(move);
+        reset();
+    }
+
+    void JointMoveIterator::setMoves(int snake, const MoveList& moves) {
+        m_moves[snake] = moves;
+        reset();
+    }
+
+    void JointMoveIterator::reset() {
+        m_done = false;
+        for (int s=0; s<m_snake_count; s++) {
+            m_index[s] = 0;
+            m_current[s] = m_moves[s][0];
+        }
+    }
+
+    //Advances like an odometer, with the last snake's move changing fastest
+    void JointMoveIterator::next() {
+        for (int s=m_snake_count-1; s>=0; s--) {
+            if (++m_index[s] < m_moves[s].size()) {
+                m_current[s] = m_moves[s][m_index[s]];
+                return;
+            }
+            m_index[s] = 0;
+            m_current[s] = m_moves[s][0];
+        }
+        m_done = true;
+    }
+
+    int JointMoveIterator::count() const {
+        int total = 1;
+        for (int s=0; s<m_snake_count; s++) {
+            total *= m_moves[s].size();
+        }
+        return total;
+    }
+} // battlesnake
@@ -0,0 +1,72 @@
+#include "neighbor_table.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+namespace battlesnake {
+    const char* directionName(Direction direction) {
+        switch (direction) {
+        case Direction::Up:
+            return "up";
+        case Direction::Down:
+            return "down";
+        case Direction::Left:
+            return "left";
+        case Direction::Right:
+            return "right";
+        }
+        return "up";
+    }
+
+    NeighborTable::NeighborTable(int width, int height, bool wrapped):
+        m_width(width), m_height(height), m_wrapped(wrapped)
+    {
+        //Neighbors are listed left, right, down, up; move ordering elsewhere relies on this
+        const std::array<std::pair<int, int>, NUM_DIRECTIONS> offsets = {{{-1, 0}, {1, 0}, {0, -1}, {0, 1}}};
+        const std::array<Direction, NUM_DIRECTIONS> directions = {
+            Direction::Left, Direction::Right, Direction::Down, Direction::Up
+        };
+        for (int y=0; y<height; y++) {
+            for (int x=0; x<width; x++) {
+                const int c = y * width + x;
+                m_neighbors[c] = NeighborList();
+                for (int i=0; i<NUM_DIRECTIONS; i++) {
+                    int nx = x + offsets[i].first;
+                    int ny = y + offsets[i].second;
+                    if (wrapped) {
+                        nx = (nx + width) % width;
+                        ny = (ny + height) % height;
+                    }
+                    Cell n = NO_CELL;
+                    if (nx >= 0 && nx < width && ny >= 0 && ny < height) {
+                        n = static_cast<Cell>(ny * width + nx);
+                        m_neighbors[c].push(n);
+                    }
+                    m_steps[c][static_cast<int>(directions[i])] = n;
+                }
+            }
+        }
+    }
+
+    const NeighborTable& NeighborTable::get(int width, int height, bool wrapped) {
+        static std::mutex tables_mutex;
+        static std::map<std::tuple<int, int, bool>, std::unique_ptr<NeighborTable>> tables;
+        std::lock_guard<std::mutex> lock(tables_mutex);
+        auto& table = tables[{width, height, wrapped}];
+        if (!table) {
+            table = std::make_unique<NeighborTable>(width, height, wrapped);
+        }
+        return *table;
+    }
+
+    Direction NeighborTable::directionTo(Cell from, Cell to) const {
+        for (int d=0; d<NUM_DIRECTIONS; d++) {
+            if (m_steps[from][d] == to) {
+                return static_cast<Direction>(d);
+            }
+        }
+        return Direction::Up;
+    }
+} // battlesnake
@@ -0,0 +1,144 @@
+#include "rules.h"
+
+namespace battlesnake {
+    Rules::Rules(const RulesetSettings& settings):
+        Rules(settings.getFoodSpawnChance(), settings.getMinimumFood(), settings.getHazardDamagePerTurn())
+    {}
+
+    Rules::Rules(int food_spawn_chance, int minimum_food, int hazard_damage):
+        m_food_spawn_chance(food_spawn_chance), m_minimum_food(minimum_food), m_hazard_damage(hazard_damage)
+    {}
+
+    UndoRecord Rules::step(Board& board, const JointMove& moves, Rng* food_rng) const {
+        const uint64_t hash = board.m_hash;
+        //Snakes leaving the board are eliminated before any collision check could see them
+        uint32_t out_of_bounds = 0;
+        Bitboard stranded;
+        for (int s=0; s<board.m_snakes.count; s++) {
+            if (!board.m_snakes.alive[s]) {continue;}
+            if (board.m_neighbor_table->step(board.m_snakes.heads[s], moves[s]) == NO_CELL) {
+                out_of_bounds |= 1u << s;
+                const BodyRing& body = board.m_snakes.bodies[s];
+                for (BodyRing::Iterator it = body.begin(); it.index() < body.size() - 1; ++it) {
+                    stranded.set(*it);
+                }
+                board.removeSnake(s);
+            }
+        }
+        UndoRecord record = board.applyJointMove(moves);
+        record.hash = hash;
+        damageHazards(board, record);
+        if (food_rng != nullptr) {
+            //Their bodies are still on the board until elimination in the official rules
+            spawnFood(board, *food_rng, stranded, record);
+        }
+        record.eliminated = out_of_bounds | eliminateSnakes(board);
+        return record;
+    }
+
+    void Rules::undo(Board& board, const UndoRecord& record) const {
+        for (int s=board.m_snakes.count-1; s>=0; s--) {
+            if ((record.eliminated & record.moved) >> s & 1) {
+                board.restoreSnake(s);
+            }
+        }
+        board.m_food_bits ^= record.spawned_food;
+        board.undo(record);
+        //Snakes that left the board never moved, so they go back after everyone else has
+        for (int s=board.m_snakes.count-1; s>=0; s--) {
+            if ((record.eliminated & ~record.moved) >> s & 1) {
+                board.restoreSnake(s);
+            }
+        }
+        board.m_hash = record.hash;
+        board.m_free_after_valid = false;
+    }
+
+    //Snakes that ate this turn are on food and take no damage
+    void Rules::damageHazards(Board& board, const UndoRecord& record) const {
+        if (m_hazard_damage == 0) {return;}
+        const Zobrist& keys = Zobrist::keys();
+        SnakeStore& snakes = board.m_snakes;
+        for (int s=0; s<snakes.count; s++) {
+            if (!(record.moved >> s & 1) || (record.ate >> s & 1) || !board.m_hazard_bits.test(snakes.heads[s])) {
+                continue;
+            }
+            const int health = std::max(0, snakes.health[s] - m_hazard_damage);
+            board.m_hash ^= keys.health(s, snakes.health[s]) ^ keys.health(s, health);
+            snakes.health[s] = health;
+        }
+    }
+
+    /*
+    Tops food up to the minimum, or otherwise places one food with the configured chance. Food
+    only goes on cells without snakes, food or hazards that no head can reach next turn.
+    */
+    void Rules::spawnFood(Board& board, Rng& rng, const Bitboard& blocked, UndoRecord& record) const {
+        const int food_count = board.m_food_bits.count();
+        int to_spawn = 0;
+        if (food_count < m_minimum_food) {
+            to_spawn = m_minimum_food - food_count;
+        } else if (m_food_spawn_chance > 0 && rng.below(100) < m_food_spawn_chance) {
+            to_spawn = 1;
+        }
+        if (to_spawn == 0) {return;}
+
+        Bitboard candidates = board.m_geometry.all().andNot(
+            board.m_occupied_bits | board.m_food_bits | board.m_hazard_bits | blocked
+            | board.m_geometry.neighbors(board.m_head_bits)
+        );
+        int free_cells = candidates.count();
+        const Zobrist& keys = Zobrist::keys();
+        for (; to_spawn > 0 && free_cells > 0; to_spawn--, free_cells--) {
+            int pick = rng.below(free_cells);
+            int cell = -1;
+            candidates.forEach([&](int c) {
+                if (pick-- == 0) {cell = c;}
+            });
+            candidates.reset(cell);
+            board.m_food_bits.set(cell);
+            record.spawned_food.set(cell);
+            board.m_hash ^= keys.food(static_cast<Cell>(cell));
+        }
+    }
+
+    /*
+    Removes snakes that starved, then every snake whose head hit a body segment (its own or
+    another's) or met a head at least as long. Collisions are judged against the board after
+    starvation, and all colliding snakes are removed together. Returns the removed snakes.
+    */
+    uint32_t Rules::eliminateSnakes(Board& board) const {
+        const SnakeStore& snakes = board.m_snakes;
+        uint32_t eliminated = 0;
+        for (int s=0; s<snakes.count; s++) {
+            if (snakes.alive[s] && snakes.health[s] <= 0) {
+                eliminated |= 1u << s;
+                board.removeSnake(s);
+            }
+        }
+        uint32_t collided = 0;
+        for (int s=0; s<snakes.count; s++) {
+            if (!snakes.alive[s]) {continue;}
+            const Cell head = snakes.heads[s];
+            int heads_here = 0;
+            bool lost_head_to_head = false;
+            for (int o=0; o<snakes.count; o++) {
+                if (!snakes.alive[o] || snakes.heads[o] != head) {continue;}
+                heads_here++;
+                if (o != s && snakes.lengths[s] <= snakes.lengths[o]) {
+                    lost_head_to_head = true;
+                }
+            }
+            //Every living head is one segment of the count, anything beyond that is a body
+            if (lost_head_to_head || board.m_occupancy[head] > heads_here) {
+                collided |= 1u << s;
+            }
+        }
+        for (int s=0; s<snakes.count; s++) {
+            if (collided >> s & 1) {
+                board.removeSnake(s);
+            }
+        }
+        return eliminated | collided;
+    }
+} // battlesnake
@@ -0,0 +1,321 @@
+#include "search.h"
+#include "evaluation.h"
+#include "movegen.h"
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace battlesnake {
+    //Nodes between deadline checks, keeps clock reads off the hot path
+    constexpr uint64_t TIME_CHECK_INTERVAL = 256;
+
+    HistoryTable::HistoryTable(): m_scores(std::make_unique<Scores>()) {
+        clear();
+    }
+
+    void HistoryTable::clear() {
+        for (auto& snake : *m_scores) {
+            for (auto& cell : snake) {
+                cell.fill(0);
+            }
+        }
+    }
+
+    void HistoryTable::reward(int snake, Cell from, Direction move, int depth) {
+        int32_t& entry = (*m_scores)[snake][from][static_cast<int>(move)];
+        entry += depth * depth;
+        if (entry >= MAX_SCORE) {
+            for (auto& cell : (*m_scores)[snake]) {
+                for (int32_t& score : cell) {
+                    score /= 2;
+                }
+            }
+        }
+    }
+
+    void HistoryTable::order(MoveList& moves, int snake, Cell from) const {
+        std::stable_sort(moves.moves.begin(), moves.moves.begin() + moves.size(), [&](Direction a, Direction b) {
+            return score(snake, from, a) > score(snake, from, b);
+        });
+    }
+
+    AlphaBetaSearch::AlphaBetaSearch(const Rules& rules, TranspositionTable* table):
+        m_rules(rules), m_table(table)
+    {}
+
+    //Decided scores count plies from the root; the table stores them counted from the node instead
+    static int scoreToTable(int score, int ply) {
+        if (score >= WIN_SCORE - MAX_SEARCH_PLY) {return score + ply;}
+        if (score <= -WIN_SCORE + MAX_SEARCH_PLY) {return score - ply;}
+        return score;
+    }
+
+    static int scoreFromTable(int score, int ply) {
+        if (score >= WIN_SCORE - MAX_SEARCH_PLY) {return score - ply;}
+        if (score <= -WIN_SCORE + MAX_SEARCH_PLY) {return score + ply;}
+        return score;
+    }
+
+    SearchResult AlphaBetaSearch::search(const Board& root, int subject, const SearchLimits& limits) {
+        Board board = root;
+        m_board = &board;
+        m_subject = subject;
+        m_subject_key = Zobrist::keys().subject(subject);
+        m_limits = limits;
+        m_nodes = 0;
+        m_stopped = false;
+        m_solo = board.aliveCount() <= 1;
+        m_extensions = 0;
+        m_history.clear();
+        m_killers.fill(std::nullopt);
+        m_reply_killers.fill(std::nullopt);
+
+        SearchResult result;
+        MoveList root_moves = orderedMoves(board, subject, legalMoves(board, subject));
+        result.move = root_moves[0];
+        //Nothing to decide, answer straight away and leave the time to the caller
+        if (root_moves.size() == 1) {
+            result.depth = 1;
+            return result;
+        }
+        if (m_helper_id > 0) {
+            const int shift = m_helper_id % root_moves.size();
+            std::rotate(root_moves.moves.begin(), root_moves.moves.begin() + shift, root_moves.moves.begin() + root_moves.size());
+        }
+        for (int depth=1 + m_helper_id % 2; depth<=limits.max_depth; depth++) {
+            int alpha = -INFINITE_SCORE;
+            Direction best_move = root_moves[0];
+            for (Direction move : root_moves) {
+                const int score = minNode(move, depth, 0, alpha, INFINITE_SCORE);
+                if (m_stopped) {break;}
+                if (score > alpha) {
+                    alpha = score;
+                    best_move = move;
+                }
+            }
+            if (m_stopped) {break;}
+            result.move = best_move;
+            result.score = alpha;
+            result.depth = depth;
+            //Search the previous best first next iteration, it tightens the window soonest
+            root_moves.moveToFront(best_move);
+            //A proven result cannot change with more depth
+            if (std::abs(alpha) >= WIN_SCORE - MAX_SEARCH_PLY) {break;}
+        }
+        result.nodes = m_nodes;
+        m_board = nullptr;
+        return result;
+    }
+
+    bool AlphaBetaSearch::timeUp() {
+        if (m_nodes % TIME_CHECK_INTERVAL == 0) {
+            if (SearchClock::now() >= m_limits.deadline || m_limits.stopSignalled()) {
+                m_stopped = true;
+            }
+        }
+        return m_stopped;
+    }
+
+    //Scores finished games: our death is a loss, being the last snake left is a win
+    bool AlphaBetaSearch::isDecided(int ply, int& score) const {
+        const SnakeStore& snakes = m_board->m_snakes;
+        if (!snakes.alive[m_subject]) {
+            score = -WIN_SCORE + ply;
+            return true;
+        }
+        if (!m_solo && m_board->aliveCount() == 1) {
+            score = WIN_SCORE - ply;
+            return true;
+        }
+        return false;
+    }
+
+    /*
+    Scores a horizon position with our head in contact without searching it. A move is lost when
+    a head at least as long can reach the same cell, so with no other move we lose next turn. In
+    a duel, an opponent whose only move we can reach while longer loses next turn.
+    */
+    int AlphaBetaSearch::resolveContact(int ply) const {
+        const Board& board = *m_board;
+        const SnakeStore& snakes = board.m_snakes;
+        const NeighborTable& table = *board.m_neighbor_table;
+        const int length = snakes.lengths[m_subject];
+        Bitboard threatened;
+        Cell cornered = NO_CELL;
+        for (int s=0; s<snakes.count; s++) {
+            if (s == m_subject || !snakes.alive[s]) {continue;}
+            const MoveMask moves = legalMoves(board, s);
+            for (int d=0; d<NUM_DIRECTIONS; d++) {
+                if (!(moves & directionBit(static_cast<Direction>(d)))) {continue;}
+                const Cell c = table.step(snakes.heads[s], static_cast<Direction>(d));
+                if (snakes.lengths[s] >= length) {
+                    threatened.set(c);
+                }
+                if (board.aliveCount() == 2 && std::popcount(moves) == 1 && snakes.lengths[s] < length) {
+                    cornered = c;
+                }
+            }
+        }
+        //Moving onto the cornered snake's cell must not cost us our last health
+        const bool can_strike = snakes.health[m_subject] > 1 + m_rules.hazardDamage();
+        const MoveMask ours = legalMoves(board, m_subject);
+        bool safe = false;
+        for (int d=0; d<NUM_DIRECTIONS; d++) {
+            if (!(ours & directionBit(static_cast<Direction>(d)))) {continue;}
+            const Cell c = table.step(snakes.heads[m_subject], static_cast<Direction>(d));
+            if (c == cornered && can_strike) {
+                return WIN_SCORE - (ply + 1);
+            }
+            safe = safe || !threatened.test(c);
+        }
+        if (!safe) {
+            return -WIN_SCORE + ply + 1;
+        }
+        return evaluate(board, m_subject);
+    }
+
+    int AlphaBetaSearch::maxNode(int depth, int ply, int alpha, int beta) {
+        m_nodes++;
+        if (timeUp()) {return 0;}
+        int score;
+        if (isDecided(ply, score)) {
+            return score;
+        }
+        if (depth == 0) {
+            if (!m_solo && headsInContact(*m_board, m_subject)) {
+                return resolveContact(ply);
+            }
+            return evaluate(*m_board, m_subject);
+        }
+        const uint64_t hash = m_board->hash() ^ m_subject_key;
+        TTEntry entry;
+        const bool hit = m_table != nullptr && m_table->probe(hash, entry);
+        if (hit && entry.depth >= depth) {
+            const int stored = scoreFromTable(entry.score, ply);
+            if (entry.bound == Bound::Exact
+                || (entry.bound == Bound::Lower && stored >= beta)
+                || (entry.bound == Bound::Upper && stored <= alpha)) {
+                return stored;
+            }
+        }
+        const Cell head = m_board->m_snakes.heads[m_subject];
+        MoveList moves = orderedMoves(*m_board, m_subject, legalMoves(*m_board, m_subject));
+        m_history.order(moves, m_subject, head);
+        if (m_killers[ply]) {
+            moves.moveToFront(*m_killers[ply]);
+        }
+        if (hit) {
+            moves.moveToFront(entry.move);
+        } else if (m_helper_id > 0 && moves.size() > 1) {
+            moves.moveToFront(moves[(m_helper_id + ply) % moves.size()]);
+        }
+        const int original_alpha = alpha;
+        int best = -INFINITE_SCORE;
+        Direction best_move = moves[0];
+        for (Direction move : moves) {
+            const int value = minNode(move, depth, ply, alpha, beta);
+            if (m_stopped) {return 0;}
+            if (value > best) {
+                best = value;
+                best_move = move;
+            }
+            alpha = std::max(alpha, value);
+            if (alpha >= beta) {
+                m_history.reward(m_subject, head, move, depth);
+                m_killers[ply] = move;
+                break;
+            }
+        }
+        if (m_table != nullptr) {
+            const Bound bound = best <= original_alpha ? Bound::Upper
+                : best >= beta ? Bound::Lower : Bound::Exact;
+            m_table->store(hash, depth, scoreToTable(best, ply), bound, best_move);
+        }
+        return best;
+    }
+
+    //Opponents with a choice try their best history moves first, and the killer reply before anything
+    void AlphaBetaSearch::orderReplies(JointMoveIterator& replies, int ply) const {
+        const SnakeStore& snakes = m_board->m_snakes;
+        for (int s=0; s<snakes.count; s++) {
+            if (s == m_subject || !snakes.alive[s] || replies.moves(s).size() < 2) {continue;}
+            MoveList moves = replies.moves(s);
+            m_history.order(moves, s, snakes.heads[s]);
+            if (m_reply_killers[ply]) {
+                moves.moveToFront((*m_reply_killers[ply])[s]);
+            }
+            replies.setMoves(s, moves);
+        }
+    }
+
+    void AlphaBetaSearch::rewardReply(const JointMove& reply, int depth, int ply) {
+        const SnakeStore& snakes = m_board->m_snakes;
+        for (int s=0; s<snakes.count; s++) {
+            if (s != m_subject && snakes.alive[s]) {
+                m_history.reward(s, snakes.heads[s], reply[s], depth);
+            }
+        }
+        m_reply_killers[ply] = reply;
+    }
+
+    //Opponents pick their joint reply to our move, then the turn is played out
+    int AlphaBetaSearch::minNode(Direction our_move, int depth, int ply, int alpha, int beta) {
+        JointMoveIterator replies(*m_board, m_limits.opponents.masks(*m_board, m_subject));
+        replies.fix(m_subject, our_move);
+        orderReplies(replies, ply);
+        int best = INFINITE_SCORE;
+        for (; !replies.done(); replies.next()) {
+            const UndoRecord record = m_rules.step(*m_board, replies.current());
+            //Head-to-head encounters decide games, so they get a turn for free
+            const bool extend = m_extensions < MAX_CONTACT_EXTENSIONS && !m_solo
+                && headsInContact(*m_board, m_subject);
+            m_extensions += extend;
+            const int value = maxNode(depth - 1 + extend, ply + 1, alpha, beta);
+            m_extensions -= extend;
+            m_rules.undo(*m_board, record);
+            if (m_stopped) {return 0;}
+            best = std::min(best, value);
+            beta = std::min(beta, value);
+            if (alpha >= beta) {
+                rewardReply(replies.current(), depth, ply);
+                break;
+            }
+        }
+        return best;
+    }
+
+    SearchResult lazySmpSearch(
+        const Rules& rules, TranspositionTable& table, const Board& root, int subject,
+        const SearchLimits& limits, int threads
+    ) {
+        std::atomic<bool> stop(false);
+        SearchLimits helper_limits = limits;
+        helper_limits.stop = &stop;
+        std::vector<SearchResult> helper_results(std::max(0, threads - 1));
+        std::vector<std::thread> helpers;
+        for (int i=1; i<threads; i++) {
+            helpers.emplace_back([&, i]() {
+                AlphaBetaSearch helper(rules, &table);
+                helper.setHelper(i);
+                helper_results[i - 1] = helper.search(root, subject, helper_limits);
+            });
+        }
+        AlphaBetaSearch main_search(rules, &table);
+        SearchResult result = main_search.search(root, subject, limits);
+        stop.store(true, std::memory_order_relaxed);
+        for (std::thread& helper : helpers) {
+            helper.join();
+        }
+        uint64_t nodes = result.nodes;
+        for (const SearchResult& helper_result : helper_results) {
+            nodes += helper_result.nodes;
+            if (helper_result.depth > result.depth) {
+                result = helper_result;
+            }
+        }
+        result.nodes = nodes;
+        return result;
+    }
+} // battlesnake
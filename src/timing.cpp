@@ -0,0 +1,27 @@
+#include "timing.h"
+#include <algorithm>
+
+namespace battlesnake {
+    SearchClock::time_point TimeManager::deadline(SearchClock::time_point arrival, int timeout_ms) const {
+        const int budget_ms = std::max(
+            MIN_BUDGET_MS, timeout_ms - static_cast<int>(m_overhead_ms) - SAFETY_MARGIN_MS
+        );
+        return arrival + std::chrono::milliseconds(budget_ms);
+    }
+
+    void TimeManager::observeLatency(int turn, int latency_ms) {
+        //Latency describes the previous turn, and 0 means the engine did not measure it
+        if (latency_ms <= 0 || m_last_turn != turn - 1) {return;}
+        const double overhead = std::max(0, latency_ms - m_last_compute_ms);
+        if (overhead > m_overhead_ms) {
+            m_overhead_ms = overhead;
+        } else {
+            m_overhead_ms += (overhead - m_overhead_ms) * OVERHEAD_DECAY;
+        }
+    }
+
+    void TimeManager::recordResponse(int turn, std::chrono::milliseconds compute_time) {
+        m_last_turn = turn;
+        m_last_compute_ms = static_cast<int>(compute_time.count());
+    }
+} // battlesnake
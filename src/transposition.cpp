@@ -0,0 +1,67 @@
+#include "transposition.h"
+#include <bit>
+#include <stdexcept>
+
+namespace battlesnake {
+    TranspositionTable::TranspositionTable(size_t size_mb) {
+        if (size_mb == 0) {
+            throw std::invalid_argument("Transposition table needs at least 1 MB");
+        }
+        const size_t slots = std::bit_floor(size_mb * 1024 * 1024 / sizeof(Slot));
+        m_slots = std::make_unique<Slot[]>(slots);
+        m_mask = slots - 1;
+        clear();
+    }
+
+    void TranspositionTable::clear() {
+        for (uint64_t i=0; i<=m_mask; i++) {
+            m_slots[i].check.store(0, std::memory_order_relaxed);
+            m_slots[i].data.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    //Score in the low 32 bits, then depth, bound and move
+    uint64_t TranspositionTable::pack(const TTEntry& entry) {
+        return static_cast<uint32_t>(entry.score)
+            | static_cast<uint64_t>(static_cast<uint8_t>(entry.depth)) << 32
+            | static_cast<uint64_t>(entry.bound) << 40
+            | static_cast<uint64_t>(entry.move) << 42;
+    }
+
+    TTEntry TranspositionTable::unpack(uint64_t data) {
+        TTEntry entry;
+        entry.score = static_cast<int32_t>(static_cast<uint32_t>(data));
+        entry.depth = static_cast<uint8_t>(data >> 32);
+        entry.bound = static_cast<Bound>((data >> 40) & 3);
+        entry.move = static_cast<Direction>((data >> 42) & 3);
+        return entry;
+    }
+
+    bool TranspositionTable::probe(uint64_t hash, TTEntry& entry) const {
+        const Slot& slot = m_slots[hash & m_mask];
+        const uint64_t data = slot.data.load(std::memory_order_relaxed);
+        const uint64_t check = slot.check.load(std::memory_order_relaxed);
+        if ((check ^ data) != hash || data == 0) {
+            return false;
+        }
+        entry = unpack(data);
+        return entry.bound != Bound::None;
+    }
+
+    void TranspositionTable::store(uint64_t hash, int depth, int score, Bound bound, Direction move) {
+        Slot& slot = m_slots[hash & m_mask];
+        const uint64_t old_data = slot.data.load(std::memory_order_relaxed);
+        const uint64_t old_check = slot.check.load(std::memory_order_relaxed);
+        if ((old_check ^ old_data) == hash && unpack(old_data).depth > depth) {
+            return;
+        }
+        TTEntry entry;
+        entry.score = score;
+        entry.depth = depth;
+        entry.bound = bound;
+        entry.move = move;
+        const uint64_t data = pack(entry);
+        slot.check.store(hash ^ data, std::memory_order_relaxed);
+        slot.data.store(data, std::memory_order_relaxed);
+    }
+} // battlesnake
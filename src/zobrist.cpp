@@ -0,0 +1,34 @@
+#include "zobrist.h"
+#include "rng.h"
+
+namespace battlesnake {
+    Zobrist::Zobrist() {
+        Rng rng(0x5EED0B5E55ED5EEDULL);
+        for (int s=0; s<MAX_SNAKES; s++) {
+            for (int c=0; c<MAX_CELLS; c++) {
+                m_body[s][c] = rng.next();
+                m_head[s][c] = rng.next();
+            }
+            for (int b=0; b<HEALTH_BUCKETS; b++) {
+                m_health[s][b] = rng.next();
+            }
+        }
+        for (int c=0; c<MAX_CELLS; c++) {
+            m_food[c] = rng.next();
+            m_hazard[c] = rng.next();
+        }
+        for (int s=0; s<MAX_SNAKES; s++) {
+            for (int l=0; l<=MAX_CELLS; l++) {
+                m_length[s][l] = rng.next();
+            }
+        }
+        for (int s=0; s<MAX_SNAKES; s++) {
+            m_subject[s] = rng.next();
+        }
+    }
+
+    const Zobrist& Zobrist::keys() {
+        static const Zobrist zobrist_keys;
+        return zobrist_keys;
+    }
+} // battlesnake